@@ -18,12 +18,23 @@
 // Utilities
 // ============================================================================
 #include "core/async_helpers.h"     // async_convert - sync to async conversion
+#include "core/future.h"            // async_spawn - typed future<T> for a background task
+#include "core/async_generator.h"   // async_generator<T> - co_yield a stream of values
+
+// ============================================================================
+// Networking
+// ============================================================================
+#include "core/io_reactor.h"        // epoll reactor: async_recv/async_send/async_accept
 
 // ============================================================================
 // Concurrency Primitives
 // ============================================================================
 #include "core/when_all.h"          // Wait for all tasks concurrently
 #include "core/when_any.h"          // Race between tasks
+#include "core/channel.h"           // MPMC channel<T> between coroutines
+#include "core/async_sync.h"        // async_mutex, async_semaphore, async_manual_reset_event
+#include "core/task_group.h"        // task_group - bounded fan-out with first-error cancellation
+#include "core/parallel.h"          // parallel_for, parallel_reduce, parallel_sort
 
 // ============================================================================
 // Cancellation & Timeout
@@ -0,0 +1,162 @@
+#ifndef TASK_DO_ASYNC_GENERATOR_H
+#define TASK_DO_ASYNC_GENERATOR_H
+
+#include "task.h"
+#include "frame_allocator.h"
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Lazily produced sequence whose body may co_await
+//
+//     async_generator<row> query(int fd) {
+//         while (auto r = co_await read_row(fd)) {
+//             co_yield *r;
+//         }
+//     }
+//
+//     auto rows = query(fd);
+//     while (row* r = co_await rows.next()) { ... }
+//     // or: co_await async_for_each(query(fd), [](row& r) { ... });
+//
+// The body only runs while the consumer waits in next(), and co_yield
+// suspends it until the consumer asks for the next element, so a slow
+// consumer throttles the producer and nothing is buffered. The consumer gets
+// a pointer to the yielded object itself, valid until the next call to
+// next(): elements are neither copied nor allocated.
+//
+// Control passes between the two sides by symmetric transfer: each resumes
+// on whichever thread the other one was running on, like a task continuation.
+// An exception escaping the body is rethrown from next().
+template<typename T>
+class async_generator {
+public:
+    using value_type = std::remove_reference_t<T>;
+
+    struct promise_type {
+        // Symmetric transfer back to whoever is waiting in next()
+        struct yield_awaiter {
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                return h.promise().consumer_;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        async_generator get_return_object() noexcept {
+            return async_generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        yield_awaiter final_suspend() noexcept {
+            value_ = nullptr;
+            return {};
+        }
+
+        // Frames come from per-thread pools instead of the global heap
+        static void* operator new(std::size_t size) {
+            return frame_allocator::allocate(size);
+        }
+
+        static void operator delete(void* ptr, std::size_t size) noexcept {
+            frame_allocator::deallocate(ptr, size);
+        }
+
+        // The yielded object outlives the suspension, so point at it
+        yield_awaiter yield_value(value_type& value) noexcept {
+            value_ = std::addressof(value);
+            return {};
+        }
+
+        yield_awaiter yield_value(value_type&& value) noexcept {
+            value_ = std::addressof(value);
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            exception_ = std::current_exception();
+        }
+
+        value_type* value_ = nullptr;
+        std::coroutine_handle<> consumer_;
+        std::exception_ptr exception_;
+    };
+
+    // co_await gen.next(): pointer to the next element, nullptr once done
+    struct next_awaiter {
+        std::coroutine_handle<promise_type> coro_;
+
+        bool await_ready() const noexcept { return !coro_ || coro_.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept {
+            coro_.promise().consumer_ = consumer;
+            return coro_;
+        }
+
+        value_type* await_resume() {
+            if (!coro_) {
+                return nullptr;
+            }
+            promise_type& p = coro_.promise();
+            if (p.exception_) {
+                std::rethrow_exception(std::exchange(p.exception_, nullptr));
+            }
+            return coro_.done() ? nullptr : p.value_;
+        }
+    };
+
+    async_generator() noexcept = default;
+
+    async_generator(async_generator&& other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {}
+
+    async_generator& operator=(async_generator&& other) noexcept {
+        if (this != &other) {
+            if (coro_) {
+                coro_.destroy();
+            }
+            coro_ = std::exchange(other.coro_, nullptr);
+        }
+        return *this;
+    }
+
+    async_generator(const async_generator&) = delete;
+    async_generator& operator=(const async_generator&) = delete;
+
+    // Must not run while the body is active, only between next() calls
+    ~async_generator() {
+        if (coro_) {
+            coro_.destroy();
+        }
+    }
+
+    // Resume the body until its next co_yield or its end
+    [[nodiscard]] next_awaiter next() noexcept { return next_awaiter{coro_}; }
+
+    bool done() const noexcept { return !coro_ || coro_.done(); }
+
+private:
+    explicit async_generator(std::coroutine_handle<promise_type> h) noexcept : coro_(h) {}
+
+    std::coroutine_handle<promise_type> coro_;
+};
+
+// Loop over a generator: fn(element&) per element. If fn returns a task,
+// it is awaited before the next element is requested.
+template<typename T, typename Fn>
+task<void> async_for_each(async_generator<T> gen, Fn fn) {
+    while (auto* value = co_await gen.next()) {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, decltype(*value)>>) {
+            fn(*value);
+        } else {
+            co_await fn(*value);
+        }
+    }
+}
+
+#endif //TASK_DO_ASYNC_GENERATOR_H
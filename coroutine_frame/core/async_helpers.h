@@ -16,7 +16,7 @@
 // For functions that return a value
 template<typename Func>
 auto async_convert(Func&& func) -> task<std::invoke_result_t<Func>> {
-    co_await schedule_on(get_global_executor());
+    co_await schedule_on(current_executor());
     // Exception thrown here will be caught by promise_type::unhandled_exception()
     co_return func();
 }
@@ -25,7 +25,7 @@ auto async_convert(Func&& func) -> task<std::invoke_result_t<Func>> {
 template<typename Func>
 requires std::is_void_v<std::invoke_result_t<Func>>
 task<void> async_convert_void(Func&& func) {
-    co_await schedule_on(get_global_executor());
+    co_await schedule_on(current_executor());
     func();
     co_return;
 }
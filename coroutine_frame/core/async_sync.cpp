@@ -0,0 +1,140 @@
+#include "async_sync.h"
+
+bool async_mutex::lock_awaiter::await_suspend(std::coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    exec_ = &current_executor();
+    void* old = mutex_.state_.load(std::memory_order_relaxed);
+    while (true) {
+        if (old == mutex_.unlocked()) {
+            // Released in the meantime: take it and keep running
+            if (mutex_.state_.compare_exchange_weak(old, nullptr, std::memory_order_acquire,
+                                                    std::memory_order_relaxed)) {
+                return false;
+            }
+        } else {
+            next_ = static_cast<lock_awaiter*>(old);
+            if (mutex_.state_.compare_exchange_weak(old, this, std::memory_order_release,
+                                                    std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+}
+
+void async_mutex::unlock() {
+    lock_awaiter* next = waiters_;
+    if (!next) {
+        void* old = state_.load(std::memory_order_relaxed);
+        if (!old && state_.compare_exchange_strong(old, unlocked(), std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+            return;
+        }
+
+        // Take every waiter pushed so far and reverse them into FIFO order
+        old = state_.exchange(nullptr, std::memory_order_acquire);
+        auto* w = static_cast<lock_awaiter*>(old);
+        while (w) {
+            lock_awaiter* newer = w->next_;
+            w->next_ = next;
+            next = w;
+            w = newer;
+        }
+    }
+
+    // Hand the mutex over without releasing it
+    waiters_ = next->next_;
+    next->exec_->schedule(next->handle_);
+}
+
+bool async_semaphore::try_acquire() {
+    size_t count = count_.load(std::memory_order_relaxed);
+    while (count > 0) {
+        if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool async_semaphore::acquire_awaiter::await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    exec_ = &current_executor();
+    std::lock_guard<std::mutex> lock(semaphore_.mutex_);
+    // release() only adds permits under the lock when nobody waits, so a
+    // zero count seen here stays zero until a release() hands us one
+    if (semaphore_.try_acquire()) {
+        return false;
+    }
+    if (semaphore_.tail_) {
+        semaphore_.tail_->next_ = this;
+    } else {
+        semaphore_.head_ = this;
+    }
+    semaphore_.tail_ = this;
+    return true;
+}
+
+void async_semaphore::release(size_t n) {
+    acquire_awaiter* ready = nullptr;
+    acquire_awaiter** ready_tail = &ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (; n > 0 && head_; --n) {
+            acquire_awaiter* w = head_;
+            head_ = w->next_;
+            if (!head_) {
+                tail_ = nullptr;
+            }
+            w->next_ = nullptr;
+            *ready_tail = w;
+            ready_tail = &w->next_;
+        }
+        if (n > 0) {
+            count_.fetch_add(n, std::memory_order_release);
+        }
+    }
+
+    // Scheduling is the last access: once resumed, a waiter may be destroyed
+    while (ready) {
+        acquire_awaiter* next = ready->next_;
+        ready->exec_->schedule(ready->handle_);
+        ready = next;
+    }
+}
+
+bool async_manual_reset_event::awaiter::await_suspend(std::coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    exec_ = &current_executor();
+    void* old = event_.state_.load(std::memory_order_acquire);
+    while (old != event_.set_state()) {
+        next_ = static_cast<awaiter*>(old);
+        if (event_.state_.compare_exchange_weak(old, this, std::memory_order_release,
+                                                std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;  // Set in the meantime
+}
+
+void async_manual_reset_event::set() {
+    void* old = state_.exchange(set_state(), std::memory_order_acq_rel);
+    if (old == set_state()) {
+        return;
+    }
+
+    // Resume in arrival order
+    auto* w = static_cast<awaiter*>(old);
+    awaiter* ready = nullptr;
+    while (w) {
+        awaiter* newer = w->next_;
+        w->next_ = ready;
+        ready = w;
+        w = newer;
+    }
+    while (ready) {
+        awaiter* next = ready->next_;
+        ready->exec_->schedule(ready->handle_);
+        ready = next;
+    }
+}
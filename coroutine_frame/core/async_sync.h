@@ -0,0 +1,196 @@
+#ifndef TASK_DO_ASYNC_SYNC_H
+#define TASK_DO_ASYNC_SYNC_H
+
+#include "executor.h"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+
+// Coroutine-aware synchronization: a coroutine that has to wait suspends and
+// queues itself in its awaiter (no allocation), and is scheduled back on the
+// executor it suspended on once it may proceed. No worker thread ever blocks.
+
+class async_mutex;
+
+// RAII ownership of an async_mutex, from co_await m.scoped_lock()
+class async_mutex_lock {
+public:
+    explicit async_mutex_lock(async_mutex& m) noexcept : mutex_(&m) {}
+    async_mutex_lock(async_mutex_lock&& other) noexcept : mutex_(other.mutex_) { other.mutex_ = nullptr; }
+    async_mutex_lock(const async_mutex_lock&) = delete;
+    async_mutex_lock& operator=(const async_mutex_lock&) = delete;
+    async_mutex_lock& operator=(async_mutex_lock&&) = delete;
+    ~async_mutex_lock();
+
+private:
+    async_mutex* mutex_;
+};
+
+// Mutual exclusion for coroutines
+//
+//     auto lock = co_await m.scoped_lock();   // released at scope exit
+//
+// Lock-free: one atomic word holds "unlocked", "locked" or the stack of
+// waiters pushed since the last unlock. unlock() hands the mutex straight to
+// the oldest waiter, so waiters acquire it in FIFO order.
+class async_mutex {
+public:
+    async_mutex() noexcept = default;
+    ~async_mutex() = default;
+
+    async_mutex(const async_mutex&) = delete;
+    async_mutex& operator=(const async_mutex&) = delete;
+
+    class lock_awaiter {
+    public:
+        explicit lock_awaiter(async_mutex& m) noexcept : mutex_(m) {}
+
+        bool await_ready() noexcept { return mutex_.try_lock(); }
+        bool await_suspend(std::coroutine_handle<> handle) noexcept;
+        void await_resume() noexcept {}
+
+    protected:
+        friend class async_mutex;
+
+        async_mutex& mutex_;
+        std::coroutine_handle<> handle_;
+        executor* exec_ = nullptr;
+        lock_awaiter* next_ = nullptr;
+    };
+
+    class scoped_lock_awaiter : public lock_awaiter {
+    public:
+        using lock_awaiter::lock_awaiter;
+
+        [[nodiscard]] async_mutex_lock await_resume() noexcept { return async_mutex_lock(mutex_); }
+    };
+
+    bool try_lock() noexcept {
+        void* expected = unlocked();
+        return state_.compare_exchange_strong(expected, nullptr, std::memory_order_acquire,
+                                              std::memory_order_relaxed);
+    }
+
+    // co_await m.lock() ... m.unlock()
+    lock_awaiter lock() noexcept { return lock_awaiter{*this}; }
+
+    // co_await m.scoped_lock() returns an async_mutex_lock
+    scoped_lock_awaiter scoped_lock() noexcept { return scoped_lock_awaiter{*this}; }
+
+    void unlock();
+
+private:
+    // state_: unlocked(), nullptr (locked, nobody waiting) or the newest waiter
+    void* unlocked() noexcept { return this; }
+
+    std::atomic<void*> state_{unlocked()};
+    lock_awaiter* waiters_ = nullptr;  // FIFO, owned by the lock holder
+};
+
+inline async_mutex_lock::~async_mutex_lock() {
+    if (mutex_) {
+        mutex_->unlock();
+    }
+}
+
+// Counting semaphore for coroutines
+//
+//     async_semaphore slots(8);
+//     co_await slots.acquire();  ...  slots.release();
+//
+// Waiters are served in FIFO order. The internal lock only guards the
+// counter and the waiter list, never a suspension.
+class async_semaphore {
+public:
+    explicit async_semaphore(size_t initial) noexcept : count_(initial) {}
+
+    async_semaphore(const async_semaphore&) = delete;
+    async_semaphore& operator=(const async_semaphore&) = delete;
+
+    class acquire_awaiter {
+    public:
+        explicit acquire_awaiter(async_semaphore& s) noexcept : semaphore_(s) {}
+
+        bool await_ready() noexcept { return semaphore_.try_acquire(); }
+        bool await_suspend(std::coroutine_handle<> handle);
+        void await_resume() noexcept {}
+
+    private:
+        friend class async_semaphore;
+
+        async_semaphore& semaphore_;
+        std::coroutine_handle<> handle_;
+        executor* exec_ = nullptr;
+        acquire_awaiter* next_ = nullptr;
+    };
+
+    acquire_awaiter acquire() noexcept { return acquire_awaiter{*this}; }
+
+    bool try_acquire();
+
+    // Wake up to n waiters; permits nobody is waiting for are kept
+    void release(size_t n = 1);
+
+    // Approximate number of free permits
+    size_t available() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex_;
+    std::atomic<size_t> count_;  // Written under mutex_
+    acquire_awaiter* head_ = nullptr;
+    acquire_awaiter* tail_ = nullptr;
+};
+
+// Event that stays signalled until reset()
+//
+//     co_await ready;   // Suspends until ready.set()
+//
+// Lock-free: one atomic word holds "set" or the stack of waiters; set()
+// schedules every waiter.
+class async_manual_reset_event {
+public:
+    explicit async_manual_reset_event(bool initially_set = false) noexcept
+        : state_(initially_set ? set_state() : nullptr) {}
+
+    async_manual_reset_event(const async_manual_reset_event&) = delete;
+    async_manual_reset_event& operator=(const async_manual_reset_event&) = delete;
+
+    class awaiter {
+    public:
+        explicit awaiter(async_manual_reset_event& e) noexcept : event_(e) {}
+
+        bool await_ready() const noexcept { return event_.is_set(); }
+        bool await_suspend(std::coroutine_handle<> handle) noexcept;
+        void await_resume() noexcept {}
+
+    private:
+        friend class async_manual_reset_event;
+
+        async_manual_reset_event& event_;
+        std::coroutine_handle<> handle_;
+        executor* exec_ = nullptr;
+        awaiter* next_ = nullptr;
+    };
+
+    awaiter operator co_await() noexcept { return awaiter{*this}; }
+
+    bool is_set() const noexcept { return state_.load(std::memory_order_acquire) == set_state(); }
+
+    void set();
+
+    // No effect on coroutines already released by set()
+    void reset() noexcept {
+        void* expected = set_state();
+        state_.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed);
+    }
+
+private:
+    // state_: set_state(), nullptr (not set) or the newest waiter
+    const void* set_state() const noexcept { return this; }
+    void* set_state() noexcept { return this; }
+
+    std::atomic<void*> state_;
+};
+
+#endif //TASK_DO_ASYNC_SYNC_H
@@ -0,0 +1,114 @@
+#ifndef TASK_DO_BOUNDED_MPMC_QUEUE_H
+#define TASK_DO_BOUNDED_MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+// Bounded lock-free MPMC queue
+// (Vyukov's array queue: each cell's sequence number says whether it is free
+// for the producer or filled for the consumer of the current lap)
+//
+// Any thread may push and pop. try_push() fails instead of growing when full.
+// Capacity is rounded up to a power of two.
+template<typename T>
+class bounded_mpmc_queue {
+public:
+    explicit bounded_mpmc_queue(size_t capacity)
+        : mask_(round_up(capacity) - 1), cells_(new cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~bounded_mpmc_queue() {
+        while (try_pop()) {
+        }
+    }
+
+    bounded_mpmc_queue(const bounded_mpmc_queue&) = delete;
+    bounded_mpmc_queue& operator=(const bounded_mpmc_queue&) = delete;
+
+    // False when the queue is full; `value` is only moved from on success
+    template<typename U>
+    bool try_push(U&& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        cell* c;
+        while (true) {
+            c = &cells_[pos & mask_];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        ::new (static_cast<void*>(c->storage)) T(std::forward<U>(value));
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Oldest element, or nullopt when empty
+    std::optional<T> try_pop() {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        cell* c;
+        while (true) {
+            c = &cells_[pos & mask_];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* slot = std::launder(reinterpret_cast<T*>(c->storage));
+        std::optional<T> value(std::move(*slot));
+        slot->~T();
+        c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return value;
+    }
+
+    // Approximate number of queued elements
+    size_t size() const noexcept {
+        size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static size_t round_up(size_t n) {
+        size_t cap = 2;
+        while (cap < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    size_t mask_;
+    std::unique_ptr<cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+#endif //TASK_DO_BOUNDED_MPMC_QUEUE_H
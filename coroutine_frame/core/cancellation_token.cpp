@@ -0,0 +1,78 @@
+#include "cancellation_token.h"
+
+void cancellation_token::cancel() {
+    detail::cancellation_state& st = *state_;
+    if (st.cancelled.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(st.mutex);
+    while (cancellation_registration* reg = st.head) {
+        st.head = reg->next_;
+        if (st.head) {
+            st.head->prev_ = nullptr;
+        }
+        reg->linked_ = false;
+        st.running = reg;
+        st.running_thread = std::this_thread::get_id();
+
+        // Run without the lock so the callback may attach or reset others
+        auto fn = reg->fn_;
+        void* ctx = reg->ctx_;
+        lock.unlock();
+        fn(ctx);
+        lock.lock();
+
+        st.running = nullptr;
+        st.callback_done.notify_all();
+    }
+}
+
+void cancellation_registration::attach(const cancellation_token& token, void (*fn)(void*), void* ctx) {
+    reset();
+    fn_ = fn;
+    ctx_ = ctx;
+
+    detail::cancellation_state& st = *token.state_;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        // cancel() sets the flag before draining under this lock, so either
+        // it sees this registration or we see the flag
+        if (!st.cancelled.load(std::memory_order_acquire)) {
+            state_ = token.state_;
+            prev_ = nullptr;
+            next_ = st.head;
+            if (st.head) {
+                st.head->prev_ = this;
+            }
+            st.head = this;
+            linked_ = true;
+            return;
+        }
+    }
+    fn(ctx);
+}
+
+void cancellation_registration::reset() noexcept {
+    if (!state_) {
+        return;
+    }
+    detail::cancellation_state& st = *state_;
+    {
+        std::unique_lock<std::mutex> lock(st.mutex);
+        if (linked_) {
+            if (prev_) {
+                prev_->next_ = next_;
+            } else {
+                st.head = next_;
+            }
+            if (next_) {
+                next_->prev_ = prev_;
+            }
+            linked_ = false;
+        } else if (st.running == this && st.running_thread != std::this_thread::get_id()) {
+            st.callback_done.wait(lock, [&] { return st.running != this; });
+        }
+    }
+    state_.reset();
+}
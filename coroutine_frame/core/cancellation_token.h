@@ -6,9 +6,17 @@
 #define TASK_DO_CANCELLATION_TOKEN_H
 
 #include "task.h"
+#include "executor.h"
+#include "timer_wheel.h"
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 
 // Exception thrown when a task is cancelled
 class task_cancelled : public std::exception {
@@ -18,52 +26,117 @@ public:
     }
 };
 
+class cancellation_registration;
+
+namespace detail {
+    // Shared by every copy of one token
+    struct cancellation_state {
+        std::atomic<bool> cancelled{false};
+
+        // Registered callbacks, and the one cancel() is running right now
+        std::mutex mutex;
+        std::condition_variable callback_done;
+        cancellation_registration* head = nullptr;
+        cancellation_registration* running = nullptr;
+        std::thread::id running_thread;
+    };
+}
+
 // Cancellation token that can be checked by coroutines
+// Copies share one state; cancel() on any copy runs the registered callbacks
 class cancellation_token {
 public:
-    cancellation_token() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
-    
-    // Request cancellation
-    void cancel() {
-        cancelled_->store(true, std::memory_order_release);
-    }
-    
+    cancellation_token() : state_(std::make_shared<detail::cancellation_state>()) {}
+
+    // Request cancellation and run the registered callbacks on this thread
+    void cancel();
+
     // Check if cancellation was requested
     bool is_cancelled() const {
-        return cancelled_->load(std::memory_order_acquire);
+        return state_->cancelled.load(std::memory_order_acquire);
     }
-    
+
     // Throw if cancelled
     void throw_if_cancelled() const {
         if (is_cancelled()) {
             throw task_cancelled();
         }
     }
-    
+
 private:
-    std::shared_ptr<std::atomic<bool>> cancelled_;
+    friend class cancellation_registration;
+
+    std::shared_ptr<detail::cancellation_state> state_;
+};
+
+// Intrusive stop callback, in the spirit of std::stop_callback
+// fn(ctx) runs once when the token is cancelled: on the cancelling thread,
+// or inside attach() if it already was. reset() (and the destructor) unhook
+// the callback and, if it is running on another thread, wait for it to
+// return, so ctx may be freed right afterwards. Awaiters embed one and
+// attach it while suspended; it must not move while attached.
+class cancellation_registration {
+public:
+    cancellation_registration() = default;
+    cancellation_registration(const cancellation_registration&) = delete;
+    cancellation_registration& operator=(const cancellation_registration&) = delete;
+
+    ~cancellation_registration() {
+        reset();
+    }
+
+    void attach(const cancellation_token& token, void (*fn)(void*), void* ctx);
+    void reset() noexcept;
+
+private:
+    friend class cancellation_token;
+
+    std::shared_ptr<detail::cancellation_state> state_;
+    void (*fn_)(void*) = nullptr;
+    void* ctx_ = nullptr;
+
+    // Owned by the state, guarded by its mutex
+    cancellation_registration* prev_ = nullptr;
+    cancellation_registration* next_ = nullptr;
+    bool linked_ = false;
+};
+
+// Callable flavour: cancellation_callback cb(token, [&] { ... });
+template<typename F>
+class cancellation_callback {
+public:
+    cancellation_callback(const cancellation_token& token, F fn) : fn_(std::move(fn)) {
+        registration_.attach(token, [](void* self) { static_cast<cancellation_callback*>(self)->fn_(); }, this);
+    }
+
+    cancellation_callback(const cancellation_callback&) = delete;
+    cancellation_callback& operator=(const cancellation_callback&) = delete;
+
+private:
+    F fn_;
+    cancellation_registration registration_;  // Declared last: unhooked before fn_ dies
 };
 
 // Awaitable that checks for cancellation
 class cancellation_check {
 public:
-    explicit cancellation_check(const cancellation_token& token) 
+    explicit cancellation_check(const cancellation_token& token)
         : token_(token) {}
-    
+
     bool await_ready() const noexcept {
         // If already cancelled, throw immediately
         // Otherwise, don't suspend - this is just a check point
         return true;  // Don't suspend, check immediately
     }
-    
+
     void await_suspend(std::coroutine_handle<> h) const noexcept {
         // Never called since await_ready returns true
     }
-    
+
     void await_resume() const {
         token_.throw_if_cancelled();
     }
-    
+
 private:
     cancellation_token token_;
 };
@@ -73,25 +146,69 @@ inline cancellation_check check_cancelled(const cancellation_token& token) {
     return cancellation_check(token);
 }
 
-// Cancellable delay
-inline task<void> cancellable_delay(
+// Async delay that ends early, throwing task_cancelled, when `token` is
+// cancelled. The timer is disarmed from the cancellation callback, so the
+// coroutine resumes right away and no worker sleeps meanwhile.
+//
+// The coroutine resumes after two arrivals: await_suspend finishing its
+// setup, and either the timer firing or the callback disarming it
+struct cancellable_delay_awaiter : timer_node {
+    std::chrono::milliseconds duration_;
+    cancellation_token token_;
+    std::coroutine_handle<> handle_;
+    executor* exec_ = nullptr;
+    std::atomic<int> arrivals_{0};
+    bool cancelled_ = false;
+    cancellation_registration registration_;
+
+    cancellable_delay_awaiter(std::chrono::milliseconds duration, cancellation_token token)
+        : duration_(duration), token_(std::move(token)) {}
+
+    bool await_ready() {
+        cancelled_ = token_.is_cancelled();
+        return cancelled_ || duration_.count() <= 0;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        exec_ = &current_executor();
+        callback = [](timer_node& node) {
+            static_cast<cancellable_delay_awaiter&>(node).arrive();
+        };
+        // Arm first: a callback that finds the timer unarmed knows it fired
+        exec_->timers().arm(*this, duration_);
+        registration_.attach(token_, [](void* self) {
+            auto& awaiter = *static_cast<cancellable_delay_awaiter*>(self);
+            if (awaiter.exec_->timers().cancel(awaiter)) {
+                awaiter.cancelled_ = true;
+                awaiter.arrive();
+            }
+        }, this);
+        // Second arrival: the wakeup already happened, continue inline
+        return arrivals_.fetch_add(1, std::memory_order_acq_rel) == 0;
+    }
+
+    void await_resume() {
+        registration_.reset();
+        if (cancelled_) {
+            throw task_cancelled();
+        }
+    }
+
+private:
+    void arrive() {
+        if (arrivals_.fetch_add(1, std::memory_order_acq_rel) == 1) {
+            exec_->schedule(handle_);
+        }
+    }
+};
+
+// Cancellable delay: co_await cancellable_delay(100ms, token)
+inline cancellable_delay_awaiter cancellable_delay(
     std::chrono::milliseconds duration,
     const cancellation_token& token
 ) {
-    co_await schedule_on(get_global_executor());
-    
-    auto start = std::chrono::steady_clock::now();
-    auto end = start + duration;
-    
-    while (std::chrono::steady_clock::now() < end) {
-        // Check for cancellation
-        token.throw_if_cancelled();
-        
-        // Sleep in small intervals
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
-    
-    co_return;
+    return cancellable_delay_awaiter{duration, token};
 }
 
 #endif //TASK_DO_CANCELLATION_TOKEN_H
@@ -0,0 +1,462 @@
+#ifndef TASK_DO_CHANNEL_H
+#define TASK_DO_CHANNEL_H
+
+#include "executor.h"
+#include "bounded_mpmc_queue.h"
+#include "cancellation_token.h"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+// Multi-producer multi-consumer channel between coroutines
+//
+//     channel<int> ch(64);            // Bounded; channel<int> ch; is unbounded
+//     co_await ch.send(42);           // false once the channel is closed
+//     std::optional<int> v = co_await ch.recv();  // nullopt once closed and drained
+//     ch.close();
+//
+// Elements live in a lock-free ring (capacity rounded up to a power of two),
+// so send and recv take no lock while neither side has to wait. Only a
+// coroutine that finds the ring full (send) or empty (recv) takes the mutex
+// to queue itself; the other side hands it a slot or an element directly and
+// schedules it on the executor it suspended on. Unbounded channels spill
+// into a locked deque once their ring is full.
+//
+// A send racing with close() either lands before any receiver sees the
+// channel closed and empty, or returns false: nothing sent successfully is
+// lost.
+//
+// The token overloads throw task_cancelled when the token is cancelled while
+// waiting; a cancelled send drops its value.
+template<typename T>
+class channel {
+    struct waiter;
+
+public:
+    static constexpr size_t unbounded = 0;
+
+    explicit channel(size_t capacity = unbounded)
+        : bounded_(capacity != unbounded), ring_(bounded_ ? capacity : unbounded_ring_size) {}
+
+    channel(const channel&) = delete;
+    channel& operator=(const channel&) = delete;
+
+    class send_awaiter;
+    class recv_awaiter;
+
+    send_awaiter send(T value) { return send_awaiter{*this, std::move(value), std::nullopt}; }
+    send_awaiter send(T value, const cancellation_token& token) { return send_awaiter{*this, std::move(value), token}; }
+
+    recv_awaiter recv() { return recv_awaiter{*this, std::nullopt}; }
+    recv_awaiter recv(const cancellation_token& token) { return recv_awaiter{*this, token}; }
+
+    // Never suspends: false if the channel is full or closed
+    template<typename U>
+    bool try_send(U&& value) {
+        if (!push_open(std::forward<U>(value))) {
+            return false;
+        }
+        after_push();
+        return true;
+    }
+
+    // Never suspends: nullopt if the channel is empty
+    std::optional<T> try_recv() {
+        std::optional<T> value = pop();
+        if (value) {
+            after_pop();
+        }
+        return value;
+    }
+
+    // Senders waiting now and later get false; receivers drain what is
+    // left, then get nullopt
+    void close() {
+        closed_.store(true, std::memory_order_seq_cst);
+        wait_for_senders();
+        waiter* ready = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (waiter* w = pop_waiter(recv_head_, recv_tail_, recv_waiting_)) {
+                static_cast<recv_awaiter&>(*w).value_ = pop();
+                w->next = ready;
+                ready = w;
+            }
+            while (waiter* w = pop_waiter(send_head_, send_tail_, send_waiting_)) {
+                static_cast<send_awaiter&>(*w).delivered_ = false;
+                w->next = ready;
+                ready = w;
+            }
+        }
+        resume_all(ready);
+    }
+
+    bool is_closed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+    // Approximate number of buffered elements
+    size_t size() const noexcept {
+        return ring_.size() + overflow_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t unbounded_ring_size = 1024;
+
+    enum class wait_state : uint8_t { idle, queued, done };
+
+    // A suspended send or recv, linked into the channel while it waits
+    struct waiter {
+        channel& channel_;
+        std::optional<cancellation_token> token_;
+        cancellation_registration registration_;
+        std::coroutine_handle<> handle_;
+        executor* exec_ = nullptr;
+        waiter* prev = nullptr;
+        waiter* next = nullptr;
+        wait_state state = wait_state::idle;  // Guarded by channel_.mutex_
+        bool cancelled = false;
+        const bool sending;
+
+        waiter(channel& ch, std::optional<cancellation_token> token, bool is_send)
+            : channel_(ch), token_(std::move(token)), sending(is_send) {}
+
+        // Hook up the token; must run before taking the channel mutex, since a
+        // token that is already cancelled calls back inline
+        void prepare(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            exec_ = &current_executor();
+            if (token_) {
+                registration_.attach(*token_, [](void* self) {
+                    static_cast<waiter*>(self)->channel_.cancel_wait(*static_cast<waiter*>(self));
+                }, this);
+            }
+        }
+
+        void finish() {
+            registration_.reset();
+            if (cancelled) {
+                throw task_cancelled();
+            }
+        }
+    };
+
+public:
+    class send_awaiter : waiter {
+    public:
+        send_awaiter(channel& ch, T value, std::optional<cancellation_token> token)
+            : waiter(ch, std::move(token), true), value_(std::move(value)) {}
+
+        bool await_ready() {
+            delivered_ = this->channel_.push_open(std::move(*value_));
+            if (delivered_) {
+                this->channel_.after_push();
+                return true;
+            }
+            return this->channel_.closed_.load(std::memory_order_acquire);
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            this->prepare(handle);
+            return this->channel_.wait_to_send(*this);
+        }
+
+        bool await_resume() {
+            this->finish();
+            return delivered_;
+        }
+
+    private:
+        friend class channel;
+
+        std::optional<T> value_;
+        bool delivered_ = false;
+    };
+
+    class recv_awaiter : waiter {
+    public:
+        recv_awaiter(channel& ch, std::optional<cancellation_token> token) : waiter(ch, std::move(token), false) {}
+
+        bool await_ready() {
+            value_ = this->channel_.pop();
+            if (value_) {
+                this->channel_.after_pop();
+                return true;
+            }
+            if (this->channel_.closed_.load(std::memory_order_seq_cst)) {
+                // Anything sent before close() is visible now
+                this->channel_.wait_for_senders();
+                value_ = this->channel_.pop();
+                return true;
+            }
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            this->prepare(handle);
+            return this->channel_.wait_to_recv(*this);
+        }
+
+        std::optional<T> await_resume() {
+            this->finish();
+            return std::move(value_);
+        }
+
+    private:
+        friend class channel;
+
+        std::optional<T> value_;
+    };
+
+private:
+    template<typename U>
+    bool push(U&& value) {
+        if (!bounded_ && overflow_count_.load(std::memory_order_acquire) > 0) {
+            return spill(std::forward<U>(value));
+        }
+        if (ring_.try_push(std::forward<U>(value))) {
+            return true;
+        }
+        return !bounded_ && spill(std::forward<U>(value));
+    }
+
+    // push() unless the channel is closed. Pairs with wait_for_senders():
+    // either we see closed_, or whoever closed it waits for our push to land
+    template<typename U>
+    bool push_open(U&& value) {
+        sending_.fetch_add(1, std::memory_order_seq_cst);
+        bool pushed = !closed_.load(std::memory_order_seq_cst) && push(std::forward<U>(value));
+        sending_.fetch_sub(1, std::memory_order_release);
+        return pushed;
+    }
+
+    // Once closed_ is set no push can start, so this only waits out pushes
+    // already past their check; those never block
+    void wait_for_senders() const noexcept {
+        while (sending_.load(std::memory_order_seq_cst) > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Unbounded only: once anything has spilled, later sends queue behind it
+    template<typename U>
+    bool spill(U&& value) {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        overflow_.push_back(std::forward<U>(value));
+        overflow_count_.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    // The ring holds older elements than the overflow, so drain it first.
+    // try_pop() also fails on a slot whose push is still in flight; leave the
+    // overflow alone until that lands, or a sender's later element could
+    // overtake its earlier one.
+    std::optional<T> pop() {
+        std::optional<T> value = ring_.try_pop();
+        if (value || overflow_count_.load(std::memory_order_acquire) == 0 || ring_.size() > 0) {
+            return value;
+        }
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        // Recheck under the lock: it orders us after the spill we are about to
+        // take, and so after any ring push its sender made first
+        if (overflow_.empty() || ring_.size() > 0) {
+            return std::nullopt;
+        }
+        value.emplace(std::move(overflow_.front()));
+        overflow_.pop_front();
+        overflow_count_.fetch_sub(1, std::memory_order_release);
+        return value;
+    }
+
+    // Pairs with the fence a waiter issues after queuing itself: either it
+    // sees our element/slot on its retry, or we see it waiting
+    void after_push() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (recv_waiting_.load(std::memory_order_relaxed) > 0) {
+            serve_receivers();
+        }
+    }
+
+    void after_pop() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (send_waiting_.load(std::memory_order_relaxed) > 0) {
+            serve_senders();
+        }
+    }
+
+    void serve_receivers() {
+        waiter* ready = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (recv_head_) {
+                std::optional<T> value = pop();
+                if (!value) {
+                    break;
+                }
+                waiter* w = pop_waiter(recv_head_, recv_tail_, recv_waiting_);
+                static_cast<recv_awaiter&>(*w).value_ = std::move(value);
+                w->next = ready;
+                ready = w;
+            }
+        }
+        resume_all(ready);
+    }
+
+    void serve_senders() {
+        waiter* ready = nullptr;
+        bool pushed = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (send_head_) {
+                auto& sender = static_cast<send_awaiter&>(*send_head_);
+                // Once closed, close() fails the senders still queued
+                if (!push_open(std::move(*sender.value_))) {
+                    break;
+                }
+                pop_waiter(send_head_, send_tail_, send_waiting_);
+                sender.delivered_ = true;
+                sender.next = ready;
+                ready = &sender;
+                pushed = true;
+            }
+        }
+        resume_all(ready);
+        if (pushed) {
+            after_push();
+        }
+    }
+
+    // Slow paths: returns true if the coroutine stays suspended
+    bool wait_to_send(send_awaiter& sender) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (sender.cancelled) {
+                sender.state = wait_state::done;
+                return false;
+            }
+            if (closed_.load(std::memory_order_acquire)) {
+                sender.state = wait_state::done;
+                return false;
+            }
+            push_waiter(send_head_, send_tail_, send_waiting_, sender);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!push_open(std::move(*sender.value_))) {
+                return true;  // Full, or closed: close() fails us once we unlock
+            }
+            unlink_waiter(send_head_, send_tail_, send_waiting_, sender);
+            sender.state = wait_state::done;
+            sender.delivered_ = true;
+        }
+        after_push();
+        return false;
+    }
+
+    bool wait_to_recv(recv_awaiter& receiver) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (receiver.cancelled) {
+                receiver.state = wait_state::done;
+                return false;
+            }
+            push_waiter(recv_head_, recv_tail_, recv_waiting_, receiver);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            receiver.value_ = pop();
+            if (!receiver.value_) {
+                if (!closed_.load(std::memory_order_seq_cst)) {
+                    return true;
+                }
+                wait_for_senders();
+                receiver.value_ = pop();
+            }
+            unlink_waiter(recv_head_, recv_tail_, recv_waiting_, receiver);
+            receiver.state = wait_state::done;
+        }
+        if (receiver.value_) {
+            after_pop();
+        }
+        return false;
+    }
+
+    // Cancellation callback; runs on the cancelling thread
+    void cancel_wait(waiter& w) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (w.state == wait_state::done) {
+                return;  // Already served; the result stands
+            }
+            w.cancelled = true;
+            if (w.state == wait_state::idle) {
+                return;  // Not queued yet; the slow path sees the flag
+            }
+            if (w.sending) {
+                unlink_waiter(send_head_, send_tail_, send_waiting_, w);
+            } else {
+                unlink_waiter(recv_head_, recv_tail_, recv_waiting_, w);
+            }
+            w.state = wait_state::done;
+        }
+        w.exec_->schedule(w.handle_);
+    }
+
+    static void push_waiter(waiter*& head, waiter*& tail, std::atomic<size_t>& count, waiter& w) {
+        w.prev = tail;
+        w.next = nullptr;
+        if (tail) {
+            tail->next = &w;
+        } else {
+            head = &w;
+        }
+        tail = &w;
+        w.state = wait_state::queued;
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void unlink_waiter(waiter*& head, waiter*& tail, std::atomic<size_t>& count, waiter& w) {
+        (w.prev ? w.prev->next : head) = w.next;
+        (w.next ? w.next->prev : tail) = w.prev;
+        w.prev = w.next = nullptr;
+        count.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    static waiter* pop_waiter(waiter*& head, waiter*& tail, std::atomic<size_t>& count) {
+        waiter* w = head;
+        if (w) {
+            unlink_waiter(head, tail, count, *w);
+            w->state = wait_state::done;
+        }
+        return w;
+    }
+
+    // Scheduling is the last access: once resumed, a waiter may be destroyed
+    static void resume_all(waiter* ready) {
+        while (ready) {
+            waiter* next = ready->next;
+            ready->exec_->schedule(ready->handle_);
+            ready = next;
+        }
+    }
+
+    const bool bounded_;
+    bounded_mpmc_queue<T> ring_;
+    std::atomic<bool> closed_{false};
+    std::atomic<size_t> sending_{0};  // Pushes between their closed_ check and the ring
+
+    // Unbounded spill-over, only used once the ring is full
+    std::mutex overflow_mutex_;
+    std::deque<T> overflow_;
+    std::atomic<size_t> overflow_count_{0};
+
+    // Waiting coroutines (FIFO); the counts let the fast paths skip the lock
+    std::mutex mutex_;
+    waiter* send_head_ = nullptr;
+    waiter* send_tail_ = nullptr;
+    waiter* recv_head_ = nullptr;
+    waiter* recv_tail_ = nullptr;
+    std::atomic<size_t> send_waiting_{0};
+    std::atomic<size_t> recv_waiting_{0};
+};
+
+#endif //TASK_DO_CHANNEL_H
@@ -0,0 +1,143 @@
+#include "cpu_topology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <sched.h>
+#include <string>
+
+namespace {
+    // Parses the kernel's cpulist format, e.g. "0-3,8-11"
+    std::vector<int> parse_cpu_list(const std::string& text) {
+        std::vector<int> cpus;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find(',', pos);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            std::string range = text.substr(pos, end - pos);
+            pos = end + 1;
+
+            size_t dash = range.find('-');
+            char* rest = nullptr;
+            long first = std::strtol(range.c_str(), &rest, 10);
+            if (rest == range.c_str()) {
+                continue;
+            }
+            long last = dash == std::string::npos ? first : std::strtol(range.c_str() + dash + 1, nullptr, 10);
+            for (long cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+        }
+        return cpus;
+    }
+
+    std::vector<int> allowed_by_affinity() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        return cpus;
+    }
+}
+
+cpu_topology::cpu_topology() {
+    std::vector<int> allowed = allowed_by_affinity();
+    if (allowed.empty()) {
+        allowed.push_back(0);
+    }
+    cpu_to_node_.assign(static_cast<size_t>(allowed.back()) + 1, -1);
+
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream in("/sys/devices/system/node/" + name + "/cpulist");
+            std::string list;
+            std::getline(in, list);
+
+            numa_node node;
+            node.id = std::atoi(name.c_str() + 4);
+            for (int cpu : parse_cpu_list(list)) {
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                    node.cpus.push_back(cpu);
+                    cpu_to_node_[static_cast<size_t>(cpu)] = node.id;
+                }
+            }
+            if (!node.cpus.empty()) {
+                nodes_.push_back(std::move(node));
+            }
+        }
+        closedir(dir);
+    }
+
+    // No sysfs, or CPUs it did not list: treat them as node 0
+    std::vector<int> unplaced;
+    for (int cpu : allowed) {
+        if (cpu_to_node_[static_cast<size_t>(cpu)] < 0) {
+            cpu_to_node_[static_cast<size_t>(cpu)] = 0;
+            unplaced.push_back(cpu);
+        }
+    }
+    if (!unplaced.empty()) {
+        auto it = std::find_if(nodes_.begin(), nodes_.end(), [](const numa_node& n) { return n.id == 0; });
+        if (it == nodes_.end()) {
+            nodes_.push_back(numa_node{0, {}});
+            it = nodes_.end() - 1;
+        }
+        it->cpus.insert(it->cpus.end(), unplaced.begin(), unplaced.end());
+        std::sort(it->cpus.begin(), it->cpus.end());
+    }
+
+    std::sort(nodes_.begin(), nodes_.end(), [](const numa_node& a, const numa_node& b) { return a.id < b.id; });
+}
+
+const cpu_topology& cpu_topology::system() {
+    static const cpu_topology topology;
+    return topology;
+}
+
+std::vector<int> cpu_topology::allowed_cpus() const {
+    std::vector<int> cpus;
+    for (const auto& node : nodes_) {
+        cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+int cpu_topology::node_of_cpu(int cpu) const noexcept {
+    if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_to_node_.size() || cpu_to_node_[static_cast<size_t>(cpu)] < 0) {
+        return 0;
+    }
+    return cpu_to_node_[static_cast<size_t>(cpu)];
+}
+
+int cpu_topology::current_cpu() noexcept {
+    return sched_getcpu();
+}
+
+int cpu_topology::current_node() const noexcept {
+    return node_of_cpu(current_cpu());
+}
+
+bool cpu_topology::pin_current_thread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
@@ -0,0 +1,45 @@
+#ifndef TASK_DO_CPU_TOPOLOGY_H
+#define TASK_DO_CPU_TOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+
+// One NUMA node and the CPUs on it this process may run on
+struct numa_node {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+// CPUs and NUMA nodes available to the process, read once from sysfs and the
+// affinity mask. Machines without /sys/devices/system/node show up as a
+// single node 0 holding every allowed CPU.
+class cpu_topology {
+public:
+    static const cpu_topology& system();
+
+    // Nodes with at least one allowed CPU, ordered by id
+    const std::vector<numa_node>& nodes() const noexcept { return nodes_; }
+
+    // Every allowed CPU, ascending
+    std::vector<int> allowed_cpus() const;
+
+    // NUMA node id of `cpu`, or 0 when unknown
+    int node_of_cpu(int cpu) const noexcept;
+
+    // CPU the calling thread runs on right now, or -1
+    static int current_cpu() noexcept;
+
+    // NUMA node id the calling thread runs on right now, or 0
+    int current_node() const noexcept;
+
+    // Restrict the calling thread to `cpus`; false if the kernel refused
+    static bool pin_current_thread(const std::vector<int>& cpus);
+
+private:
+    cpu_topology();
+
+    std::vector<numa_node> nodes_;
+    std::vector<int> cpu_to_node_;  // Indexed by CPU id, -1 if not allowed
+};
+
+#endif //TASK_DO_CPU_TOPOLOGY_H
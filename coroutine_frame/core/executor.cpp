@@ -1,12 +1,92 @@
 #include "executor.h"
 #include "task.h"  // Required for sync_wait implementation
 #include "executor_impl.inl"  // sync_wait implementation (needs complete task<T>)
+#include "cpu_topology.h"
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <exception>
+#include <map>
+#include <optional>
+#include <pthread.h>
+#include <stdexcept>
+#include <utility>
 
-executor::executor(size_t thread_count) {
+namespace {
+    // Which executor (and which of its workers) the current thread belongs to
+    struct worker_context {
+        executor* owner = nullptr;
+        size_t index = 0;
+    };
+
+    thread_local worker_context current_worker;
+
+    // Counts schedule() calls on this thread to pick latency samples
+    thread_local uint64_t schedule_tick = 0;
+
+    // Pending flush_after_batch() callback of this worker
+    thread_local void (*batch_flush)() = nullptr;
+
+    // Sentinel stored in a probe while its timestamp is being written
+    void* const probe_busy = reinterpret_cast<void*>(uintptr_t{1});
+
+    uint64_t now_ns() noexcept {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    size_t probe_slot(void* address, size_t count) noexcept {
+        auto key = reinterpret_cast<uintptr_t>(address) >> 4;
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (count - 1);
+    }
+
+    // Only the owning worker writes its counters, so no locked RMW is needed
+    template<typename T>
+    void bump(std::atomic<T>& counter, T n = 1) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    uint64_t next_random(uint64_t& state) noexcept {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+}
+
+executor::executor(size_t thread_count)
+    : executor([thread_count] {
+          executor_config config;
+          config.thread_count = thread_count;
+          return config;
+      }()) {}
+
+executor::executor(const executor_config& config) {
+    size_t thread_count = std::max<size_t>(1, config.thread_count);
+    idle_ = config.idle;
+    name_ = config.name;
+
+    // All deques must exist before any worker starts stealing from them
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<worker>());
+    }
+    place_workers(config);
+    if (config.injection_capacity > 0) {
+        submissions_ = std::make_unique<bounded_mpmc_queue<std::coroutine_handle<>>>(config.injection_capacity);
+    }
     for (size_t i = 0; i < thread_count; ++i) {
-        workers_.emplace_back([this] { worker_thread(); });
+        workers_[i]->thread = std::thread([this, i] { worker_thread(i); });
     }
 }
 
@@ -14,64 +94,761 @@ executor::~executor() {
     shutdown();
 }
 
-void executor::schedule(std::coroutine_handle<> handle) {
+executor* executor::current() noexcept {
+    return current_worker.owner;
+}
+
+bool executor::flush_after_batch(void (*flush)()) noexcept {
+    if (!current_worker.owner || (batch_flush && batch_flush != flush)) {
+        return false;
+    }
+    batch_flush = flush;
+    return true;
+}
+
+size_t executor::local_queue_depth() noexcept {
+    executor* owner = current_worker.owner;
+    if (!owner) {
+        return 0;
+    }
+    size_t depth = 0;
+    for (auto& deque : owner->workers_[current_worker.index]->local) {
+        depth += deque.size();
+    }
+    return depth;
+}
+
+namespace {
+    // Global executor configuration and the named executors
+    struct executor_registry {
+        std::mutex mutex;
+        std::optional<executor_config> global_config;
+        bool global_created = false;
+        std::map<std::string, std::unique_ptr<executor>, std::less<>> named;
+    };
+
+    executor_registry& registry() {
+        static executor_registry instance;
+        return instance;
+    }
+
+    executor_config global_executor_config() {
+        executor_registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.global_created = true;
+        if (r.global_config) {
+            return *r.global_config;
+        }
+
+        executor_config config;
+        config.name = "global";
+        config.thread_count = 4;            // 4 worker threads
+        config.injection_capacity = 4096;   // Bound for submit() / try_schedule()
+        if (const char* env = std::getenv("TASK_DO_THREADS")) {
+            char* end = nullptr;
+            unsigned long threads = std::strtoul(env, &end, 10);
+            if (end != env && *end == '\0') {
+                config.thread_count = threads > 0 ? threads : std::thread::hardware_concurrency();
+            } else {
+                std::fprintf(stderr, "[executor] Ignoring invalid TASK_DO_THREADS=%s\n", env);
+            }
+        }
+        return config;
+    }
+}
+
+executor& get_global_executor() {
+    static executor exec(global_executor_config());
+    return exec;
+}
+
+void configure_global_executor(const executor_config& config) {
+    executor_registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.global_created) {
+        throw std::logic_error("configure_global_executor: global executor already in use");
+    }
+    r.global_config = config;
+    if (r.global_config->name.empty()) {
+        r.global_config->name = "global";
+    }
+}
+
+executor& make_executor(const executor_config& config) {
+    if (config.name.empty() || config.name == "global") {
+        throw std::invalid_argument("make_executor: executor needs a unique name");
+    }
+    auto exec = std::make_unique<executor>(config);
+    executor_registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto [it, inserted] = r.named.try_emplace(config.name, std::move(exec));
+    if (!inserted) {
+        throw std::invalid_argument("make_executor: name already taken: " + config.name);
+    }
+    return *it->second;
+}
+
+executor* find_executor(std::string_view name) {
+    if (name == "global") {
+        return &get_global_executor();
+    }
+    executor_registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.named.find(name);
+    return it == r.named.end() ? nullptr : it->second.get();
+}
+
+// Assigns every worker a node group and the CPUs it may run on. Without
+// numa_aware all workers form a single group, as before.
+void executor::place_workers(const executor_config& config) {
+    const cpu_topology& topology = cpu_topology::system();
+    std::vector<int> cpus = config.cpus.empty() ? topology.allowed_cpus() : config.cpus;
+
+    std::vector<numa_node> groups;
+    if (config.numa_aware) {
+        for (int cpu : cpus) {
+            int id = topology.node_of_cpu(cpu);
+            auto it = std::find_if(groups.begin(), groups.end(), [id](const numa_node& g) { return g.id == id; });
+            if (it == groups.end()) {
+                groups.push_back(numa_node{id, {}});
+                it = groups.end() - 1;
+            }
+            it->cpus.push_back(cpu);
+        }
+        std::sort(groups.begin(), groups.end(), [](const numa_node& a, const numa_node& b) { return a.id < b.id; });
+    }
+    if (groups.empty()) {
+        groups.push_back(numa_node{0, cpus});
+    }
+
+    int max_id = 0;
+    for (const auto& g : groups) {
+        auto node = std::make_unique<node_group>();
+        node->id = g.id;
+        nodes_.push_back(std::move(node));
+        max_id = std::max(max_id, g.id);
+    }
+    node_index_of_id_.assign(static_cast<size_t>(max_id) + 1, -1);
+    for (size_t g = 0; g < groups.size(); ++g) {
+        node_index_of_id_[static_cast<size_t>(groups[g].id)] = static_cast<int>(g);
+    }
+
+    // Workers go round-robin over the nodes, then over each node's CPUs
+    bool restrict_to_node = groups.size() > 1 || !config.cpus.empty();
+    std::vector<size_t> next_cpu(groups.size(), 0);
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        size_t g = i % groups.size();
+        worker& w = *workers_[i];
+        w.node = g;
+        nodes_[g]->workers.push_back(i);
+
+        const auto& node_cpus = groups[g].cpus;
+        if (node_cpus.empty()) {
+            continue;
+        }
+        if (config.pin_workers) {
+            w.cpus = {node_cpus[next_cpu[g]++ % node_cpus.size()]};
+        } else if (restrict_to_node) {
+            w.cpus = node_cpus;
+        }
+    }
+}
+
+// Node group of the calling (non-worker) thread, by the CPU it runs on
+size_t executor::caller_node() const noexcept {
+    if (nodes_.size() == 1) {
+        return 0;
+    }
+    int id = cpu_topology::system().current_node();
+    if (id < 0 || static_cast<size_t>(id) >= node_index_of_id_.size() ||
+        node_index_of_id_[static_cast<size_t>(id)] < 0) {
+        return 0;
+    }
+    return static_cast<size_t>(node_index_of_id_[static_cast<size_t>(id)]);
+}
+
+void executor::schedule(std::coroutine_handle<> handle, priority lane) {
+    if (stopped_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    if (++schedule_tick % latency_sample_interval == 0) {
+        sample_schedule(handle);
+    }
+
+    auto l = static_cast<size_t>(lane);
+    if (lane == priority::high) {
+        high_pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (current_worker.owner == this) {
+        // Fast path: no lock, the owning worker pushes onto its own deque
+        worker& self = *workers_[current_worker.index];
+        self.local[l].push(handle);
+        size_t depth = self.local[l].size();
+        if (depth > self.counters.queue_high_water.load(std::memory_order_relaxed)) {
+            self.counters.queue_high_water.store(depth, std::memory_order_relaxed);
+        }
+    } else {
+        injection_queue& injection = nodes_[caller_node()]->injection;
+        std::lock_guard<std::mutex> lock(injection.mutex);
+        injection.queues[l].push(handle);
+        injection.count[l].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    wake_one();
+}
+
+void executor::schedule_bulk(std::span<const std::coroutine_handle<>> handles, priority lane) {
+    if (handles.empty() || stopped_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // At most one latency sample per batch: the handle that crosses the interval
+    uint64_t before = schedule_tick;
+    schedule_tick += handles.size();
+    uint64_t first = latency_sample_interval - 1 - before % latency_sample_interval;
+    if (first < handles.size()) {
+        sample_schedule(handles[first]);
+    }
+
+    auto l = static_cast<size_t>(lane);
+    if (lane == priority::high) {
+        high_pending_.fetch_add(handles.size(), std::memory_order_relaxed);
+    }
+
+    if (current_worker.owner == this) {
+        worker& self = *workers_[current_worker.index];
+        self.local[l].push_bulk(handles);
+        size_t depth = self.local[l].size();
+        if (depth > self.counters.queue_high_water.load(std::memory_order_relaxed)) {
+            self.counters.queue_high_water.store(depth, std::memory_order_relaxed);
+        }
+    } else {
+        injection_queue& injection = nodes_[caller_node()]->injection;
+        std::lock_guard<std::mutex> lock(injection.mutex);
+        for (auto handle : handles) {
+            injection.queues[l].push(handle);
+        }
+        injection.count[l].fetch_add(handles.size(), std::memory_order_relaxed);
+    }
+
+    wake_many(handles.size());
+}
+
+void executor::schedule_later(std::coroutine_handle<> handle, priority lane) {
+    if (stopped_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    auto l = static_cast<size_t>(lane);
+    if (lane == priority::high) {
+        high_pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    injection_queue& injection = nodes_[caller_node()]->injection;
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (stopped_) {
-            return;
+        std::lock_guard<std::mutex> lock(injection.mutex);
+        injection.queues[l].push(handle);
+        injection.count[l].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    wake_one();
+}
+
+bool executor::try_schedule(std::coroutine_handle<> handle) {
+    if (push_submission(handle)) {
+        return true;
+    }
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool executor::push_submission(std::coroutine_handle<> handle) {
+    if (stopped_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (!submissions_) {
+        schedule(handle);
+        return true;
+    }
+    if (!submissions_->try_push(handle)) {
+        return false;
+    }
+    wake_one();
+    return true;
+}
+
+// Called from submit_awaiter after a failed push. Returns false when the
+// producer need not suspend: room appeared meanwhile, or the executor stopped
+// (the handle is then left to the producer).
+bool executor::wait_for_room(submit_awaiter& waiter) {
+    if (!submissions_ || stopped_.load(std::memory_order_acquire)) {
+        waiter.queued_ = false;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        // Checked again under the lock: shutdown() drains the waiters under
+        // it after setting stopped_, so nobody can queue behind the drain
+        if (stopped_.load(std::memory_order_acquire)) {
+            waiter.queued_ = false;
+            return false;
+        }
+        submit_waiting_.fetch_add(1, std::memory_order_seq_cst);
+        // Pairs with the fence in take_submitted(): either the consumer sees
+        // us waiting, or we see the slot it freed
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!submissions_->try_push(waiter.handle_)) {
+            if (submit_tail_) {
+                submit_tail_->next_ = &waiter;
+            } else {
+                submit_head_ = &waiter;
+            }
+            submit_tail_ = &waiter;
+            return true;
         }
-        task_queue_.push(handle);
+        submit_waiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    wake_one();
+    return false;
+}
+
+std::coroutine_handle<> executor::take_submitted() {
+    if (!submissions_) {
+        return {};
+    }
+    std::optional<std::coroutine_handle<>> handle = submissions_->try_pop();
+    if (!handle) {
+        return {};
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (submit_waiting_.load(std::memory_order_relaxed) > 0) {
+        admit_submitters();
+    }
+    return *handle;
+}
+
+// Moves waiting producers' handles into the freed slots and resumes them
+void executor::admit_submitters() {
+    std::lock_guard<std::mutex> lock(submit_mutex_);
+    if (stopped_.load(std::memory_order_acquire)) {
+        return;  // shutdown() resumes them with false
+    }
+    while (submit_head_ && submissions_->try_push(submit_head_->handle_)) {
+        submit_awaiter* waiter = submit_head_;
+        submit_head_ = waiter->next_;
+        if (!submit_head_) {
+            submit_tail_ = nullptr;
+        }
+        submit_waiting_.fetch_sub(1, std::memory_order_relaxed);
+        waiter->producer_exec_->schedule(waiter->producer_);
     }
-    cv_.notify_one();
 }
 
 void executor::shutdown() {
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        stopped_ = true;
+    // Pending delays never fire after shutdown, just like schedule() drops work
+    timers_.stop();
+
+    stopped_.store(true, std::memory_order_seq_cst);
+    for (auto& w : workers_) {
+        wake_sleeper(*w);
     }
-    cv_.notify_all();
     
-    for (auto& worker : workers_) {
-        if (worker.joinable()) {
-            worker.join();
+    for (auto& w : workers_) {
+        if (w->thread.joinable()) {
+            w->thread.join();
         }
     }
+
+    // Producers still waiting in submit() get false. One that ran on this
+    // executor can no longer be scheduled, so it resumes on this thread.
+    submit_awaiter* waiters;
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        waiters = std::exchange(submit_head_, nullptr);
+        submit_tail_ = nullptr;
+        submit_waiting_.store(0, std::memory_order_relaxed);
+    }
+    while (waiters) {
+        submit_awaiter* next = waiters->next_;
+        waiters->queued_ = false;
+        if (waiters->producer_exec_ == this) {
+            waiters->producer_.resume();
+        } else {
+            waiters->producer_exec_->schedule(waiters->producer_);
+        }
+        waiters = next;
+    }
 }
 
 size_t executor::pending_tasks() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return task_queue_.size();
+    size_t total = 0;
+    for (size_t l = 0; l < lane_count; ++l) {
+        for (const auto& node : nodes_) {
+            total += node->injection.count[l].load(std::memory_order_relaxed);
+        }
+        for (const auto& w : workers_) {
+            total += w->local[l].size();
+        }
+    }
+    if (submissions_) {
+        total += submissions_->size();
+    }
+    return total;
 }
 
-void executor::worker_thread() {
+executor_stats executor::stats() const {
+    executor_stats snapshot;
+    snapshot.pending_tasks = pending_tasks();
+    snapshot.latency_sample_interval = latency_sample_interval;
+    snapshot.rejected_submissions = rejected_.load(std::memory_order_relaxed);
+    snapshot.workers.resize(workers_.size());
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        const worker_counters& c = workers_[i]->counters;
+        worker_stats& w = snapshot.workers[i];
+        w.index = i;
+        w.tasks_resumed = c.tasks_resumed.load(std::memory_order_relaxed);
+        w.high_priority_resumed = c.high_priority_resumed.load(std::memory_order_relaxed);
+        w.steals = c.steals.load(std::memory_order_relaxed);
+        w.injected = c.injected.load(std::memory_order_relaxed);
+        w.parks = c.parks.load(std::memory_order_relaxed);
+        w.busy_ns = c.busy_ns.load(std::memory_order_relaxed);
+        w.idle_ns = c.idle_ns.load(std::memory_order_relaxed);
+        w.queue_high_water = c.queue_high_water.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < c.latency.size(); ++b) {
+            if (uint64_t n = c.latency[b].load(std::memory_order_relaxed)) {
+                w.schedule_latency.add(b, n);
+            }
+        }
+        w.schedule_latency.add_totals(c.latency_sum.load(std::memory_order_relaxed),
+                                      c.latency_max.load(std::memory_order_relaxed));
+    }
+    return snapshot;
+}
+
+// Remember when a sampled handle was scheduled. A probe slot already in use
+// just means this sample is skipped.
+void executor::sample_schedule(std::coroutine_handle<> handle) {
+    latency_probe& probe = probes_[probe_slot(handle.address(), latency_probe_count)];
+    void* expected = nullptr;
+    if (!probe.handle.compare_exchange_strong(expected, probe_busy, std::memory_order_acquire,
+                                              std::memory_order_relaxed)) {
+        return;
+    }
+    probe.scheduled_ns.store(now_ns(), std::memory_order_relaxed);
+    probe.handle.store(handle.address(), std::memory_order_release);
+}
+
+// Costs one shared load per resume unless the handle was sampled
+void executor::sample_resume(worker_counters& counters, std::coroutine_handle<> handle) {
+    void* address = handle.address();
+    latency_probe& probe = probes_[probe_slot(address, latency_probe_count)];
+    if (probe.handle.load(std::memory_order_acquire) != address) {
+        return;
+    }
+    uint64_t scheduled = probe.scheduled_ns.load(std::memory_order_relaxed);
+    if (!probe.handle.compare_exchange_strong(address, nullptr, std::memory_order_relaxed)) {
+        return;
+    }
+
+    uint64_t now = now_ns();
+    uint64_t latency = now > scheduled ? now - scheduled : 0;
+    bump(counters.latency[latency_histogram::bucket_for(latency)]);
+    bump(counters.latency_sum, latency);
+    if (latency > counters.latency_max.load(std::memory_order_relaxed)) {
+        counters.latency_max.store(latency, std::memory_order_relaxed);
+    }
+}
+
+// Returns one injected handle and moves up to injection_batch - 1 more onto
+// the worker's own deque, so a burst of wakeups is not drained one per poll
+std::coroutine_handle<> executor::take_injected(worker& self, size_t lane, injection_queue& injection) {
+    if (injection.count[lane].load(std::memory_order_relaxed) == 0) {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(injection.mutex);
+    auto& queue = injection.queues[lane];
+    if (queue.empty()) {
+        return {};
+    }
+    auto handle = queue.front();
+    queue.pop();
+    size_t taken = 1;
+    while (taken < injection_batch && !queue.empty()) {
+        self.local[lane].push(queue.front());
+        queue.pop();
+        ++taken;
+    }
+    injection.count[lane].fetch_sub(taken, std::memory_order_relaxed);
+    bump(self.counters.injected, static_cast<uint64_t>(taken));
+    return handle;
+}
+
+// Victims on the thief's own node first, then everyone else
+std::coroutine_handle<> executor::steal_work(size_t self, size_t lane, uint64_t& rng) {
+    size_t n = workers_.size();
+    if (n < 2) {
+        return {};
+    }
+
+    // Start at a random victim so thieves spread out instead of all
+    // hammering worker 0
+    size_t home = workers_[self]->node;
+    const auto& neighbours = nodes_[home]->workers;
+    size_t start = static_cast<size_t>(next_random(rng) % neighbours.size());
+    for (size_t i = 0; i < neighbours.size(); ++i) {
+        size_t victim = neighbours[(start + i) % neighbours.size()];
+        if (victim == self) {
+            continue;
+        }
+        if (auto handle = workers_[victim]->local[lane].steal()) {
+            bump(workers_[self]->counters.steals);
+            return handle;
+        }
+    }
+
+    if (nodes_.size() > 1) {
+        start = static_cast<size_t>(next_random(rng) % n);
+        for (size_t i = 0; i < n; ++i) {
+            size_t victim = (start + i) % n;
+            if (workers_[victim]->node == home) {
+                continue;
+            }
+            if (auto handle = workers_[victim]->local[lane].steal()) {
+                bump(workers_[self]->counters.steals);
+                return handle;
+            }
+        }
+    }
+    return {};
+}
+
+// One lane: own deque, own node's injection queue, other workers, and
+// finally the injection queues of other nodes
+std::coroutine_handle<> executor::find_work(size_t index, size_t lane, uint64_t& rng, bool poll_injection) {
+    worker& self = *workers_[index];
+    injection_queue& home = nodes_[self.node]->injection;
+    std::coroutine_handle<> handle;
+    if (poll_injection) {
+        handle = take_injected(self, lane, home);
+        if (!handle && lane == static_cast<size_t>(priority::normal)) {
+            handle = take_submitted();
+        }
+        if (!handle) {
+            // The oldest local handle, so LIFO pops cannot starve it
+            handle = self.local[lane].steal();
+        }
+    }
+    if (!handle) {
+        handle = self.local[lane].pop();
+    }
+    if (!handle) {
+        handle = take_injected(self, lane, home);
+    }
+    if (!handle && lane == static_cast<size_t>(priority::normal)) {
+        // New work admitted through submit() ranks after queued continuations
+        handle = take_submitted();
+    }
+    if (!handle) {
+        handle = steal_work(index, lane, rng);
+    }
+    for (size_t n = 0; !handle && n < nodes_.size(); ++n) {
+        if (n != self.node) {
+            handle = take_injected(self, lane, nodes_[n]->injection);
+        }
+    }
+    return handle;
+}
+
+bool executor::has_visible_work() const {
+    if (submissions_ && submissions_->size() > 0) {
+        return true;
+    }
+    for (size_t l = 0; l < lane_count; ++l) {
+        for (const auto& node : nodes_) {
+            if (node->injection.count[l].load(std::memory_order_relaxed) > 0) {
+                return true;
+            }
+        }
+        for (const auto& w : workers_) {
+            if (!w->local[l].empty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Spin, then yield, then park. Returns false once the executor is stopped
+// and no work is left.
+bool executor::idle(worker& self, uint32_t& spin_budget) {
+    for (uint32_t i = 0; i < spin_budget; ++i) {
+        if (has_visible_work()) {
+            spin_budget = std::min(idle_.spin, std::max<uint32_t>(1, spin_budget * 2));
+            return true;
+        }
+        cpu_relax();
+    }
+    for (uint32_t i = 0; i < idle_.yields; ++i) {
+        std::this_thread::yield();
+        if (has_visible_work()) {
+            return true;
+        }
+    }
+    spin_budget = std::max(idle_.spin / 16, spin_budget / 2);
+    return park(self);
+}
+
+bool executor::park(worker& self) {
     while (true) {
-        std::coroutine_handle<> handle;
-        
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            cv_.wait(lock, [this] { 
-                return stopped_ || !task_queue_.empty(); 
-            });
-            
-            if (stopped_ && task_queue_.empty()) {
+        // Counted before the flag is raised, so a waker that claims the flag
+        // never drives the counter below zero
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        self.sleeping.store(1, std::memory_order_seq_cst);
+        // Pairs with the fence in wake_one(): either the producer sees us
+        // sleeping, or we see its work here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (has_visible_work() || stopped_.load(std::memory_order_seq_cst)) {
+            // Take the flag back, unless a waker already did (and counted it)
+            if (self.sleeping.exchange(0, std::memory_order_acq_rel) == 1) {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        } else {
+            bump(self.counters.parks);
+            while (self.sleeping.load(std::memory_order_acquire) == 1) {
+                self.sleeping.wait(1, std::memory_order_acquire);
+            }
+        }
+
+        if (has_visible_work()) {
+            return true;
+        }
+        if (stopped_.load(std::memory_order_acquire)) {
+            return false;
+        }
+    }
+}
+
+// Claims `w`'s sleeping flag and wakes it; false if it was not asleep
+bool executor::wake_sleeper(worker& w) {
+    uint32_t expected = 1;
+    if (w.sleeping.load(std::memory_order_relaxed) != 1 ||
+        !w.sleeping.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return false;
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    w.sleeping.notify_one();
+    return true;
+}
+
+void executor::wake_one() {
+    wake_many(1);
+}
+
+// Wakes up to `count` parked workers, starting on the caller's node so the
+// work is picked up close to where it was queued
+void executor::wake_many(size_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    size_t home = current_worker.owner == this ? workers_[current_worker.index]->node : caller_node();
+    for (size_t n = 0; n < nodes_.size() && count > 0; ++n) {
+        for (size_t index : nodes_[(home + n) % nodes_.size()]->workers) {
+            if (wake_sleeper(*workers_[index]) && --count == 0) {
                 return;
             }
-            
-            if (!task_queue_.empty()) {
-                handle = task_queue_.front();
-                task_queue_.pop();
+        }
+    }
+}
+
+void executor::worker_thread(size_t index) {
+    current_worker = {this, index};
+    worker& self = *workers_[index];
+    if (!name_.empty()) {
+        // The kernel keeps at most 15 characters
+        std::string thread_name = (name_ + "-" + std::to_string(index)).substr(0, 15);
+        pthread_setname_np(pthread_self(), thread_name.c_str());
+    }
+    if (!self.cpus.empty() && !cpu_topology::pin_current_thread(self.cpus)) {
+        std::fprintf(stderr, "[executor] Could not set CPU affinity of worker %zu\n", index);
+    }
+    worker_counters& counters = self.counters;
+    uint64_t rng = 0x9E3779B97F4A7C15ull * (index + 1);
+    uint64_t awake_since = now_ns();
+    uint32_t tick = 0;
+    uint32_t high_streak = 0;
+    uint32_t spin_budget = idle_.spin;
+    uint32_t batch_resumes = 0;
+
+    constexpr auto high = static_cast<size_t>(priority::high);
+    constexpr auto normal = static_cast<size_t>(priority::normal);
+
+    while (true) {
+        bool poll_injection = ++tick % injection_poll_interval == 0;
+        bool normal_turn = high_streak >= high_priority_burst;
+        std::coroutine_handle<> handle;
+        bool is_high = false;
+
+        if (normal_turn) {
+            handle = find_work(index, normal, rng, poll_injection);
+        }
+        if (!handle && high_pending_.load(std::memory_order_relaxed) > 0) {
+            handle = find_work(index, high, rng, poll_injection);
+            is_high = static_cast<bool>(handle);
+        }
+        if (!handle && !normal_turn) {
+            handle = find_work(index, normal, rng, poll_injection);
+        }
+
+        if (!handle) {
+            if (batch_flush) {
+                // Local work was stolen before the batch ended
+                batch_resumes = 0;
+                std::exchange(batch_flush, nullptr)();
             }
+            uint64_t idle_since = now_ns();
+            bump(counters.busy_ns, idle_since - awake_since);
+            bool keep_running = idle(self, spin_budget);
+            awake_since = now_ns();
+            bump(counters.idle_ns, awake_since - idle_since);
+            if (!keep_running) {
+                return;
+            }
+            continue;
+        }
+
+        if (is_high) {
+            high_pending_.fetch_sub(1, std::memory_order_relaxed);
+            bump(counters.high_priority_resumed);
+            ++high_streak;
+        } else {
+            high_streak = 0;
         }
+
+        sample_resume(counters, handle);
+        bump(counters.tasks_resumed);
         
-        if (handle) {
-            try {
-                handle.resume();
-            } catch (const std::exception& e) {
-                // Log exception but don't crash the worker thread
-                std::fprintf(stderr, "[executor] Unhandled exception in coroutine: %s\n", e.what());
-            } catch (...) {
-                std::fprintf(stderr, "[executor] Unknown exception in coroutine\n");
+        try {
+            handle.resume();
+        } catch (const std::exception& e) {
+            // Log exception but don't crash the worker thread
+            std::fprintf(stderr, "[executor] Unhandled exception in coroutine: %s\n", e.what());
+        } catch (...) {
+            std::fprintf(stderr, "[executor] Unknown exception in coroutine\n");
+        }
+
+        if (batch_flush) {
+            bool batch_done = ++batch_resumes >= batch_flush_interval ||
+                              (self.local[normal].empty() && self.local[high].empty());
+            if (batch_done) {
+                batch_resumes = 0;
+                std::exchange(batch_flush, nullptr)();
             }
         }
     }
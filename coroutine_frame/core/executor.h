@@ -12,79 +12,366 @@
 #include <condition_variable>
 #include <functional>
 #include <vector>
+#include <array>
 #include <atomic>
 #include <memory>
 #include <cstdio>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include "work_stealing_deque.h"
+#include "timer_wheel.h"
+#include "executor_stats.h"
+#include "bounded_mpmc_queue.h"
 
 // Forward declaration
 template<typename T>
 class task;
 
-// Simple task executor with async task scheduling support
+// Scheduling lane; high is served first, normal keeps a guaranteed share
+enum class priority : uint8_t {
+    high = 0,
+    normal = 1,
+};
+
+// How an idle worker waits for work before it goes to sleep
+// Spinning keeps wakeup latency in the sub-microsecond range at the cost of
+// CPU; the spin budget adapts per worker (doubling while spins find work,
+// halving while they do not). Parking costs nothing while idle but a futex
+// wake (several microseconds) when work arrives.
+struct idle_policy {
+    uint32_t spin = 0;    // Max polls of the queues, with a CPU pause between
+    uint32_t yields = 0;  // Then this many std::this_thread::yield() rounds
+
+    // Park right away (default)
+    static constexpr idle_policy low_cpu() noexcept { return {}; }
+
+    // Spin up to ~50us, then yield, then park
+    static constexpr idle_policy low_latency() noexcept { return {2048, 16}; }
+};
+
+// Worker placement
+struct executor_config {
+    // Registry key for find_executor(), also used for worker thread names
+    // ("<name>-<index>"); empty for an anonymous executor
+    std::string name;
+
+    size_t thread_count = std::thread::hardware_concurrency();
+
+    // CPUs the workers may use; empty means every CPU the process may run on
+    std::vector<int> cpus;
+
+    // Pin each worker to a single CPU
+    bool pin_workers = false;
+
+    // Spread workers over NUMA nodes, keep each on its node's CPUs, and give
+    // every node its own injection queue; thieves try their own node first
+    bool numa_aware = false;
+
+    // Room in the queue behind submit() / try_schedule(); 0 means unbounded,
+    // and both then behave like schedule()
+    size_t injection_capacity = 0;
+
+    idle_policy idle = idle_policy::low_cpu();
+};
+
+struct submit_awaiter;
+
+// Work-stealing thread pool executor
+// Each worker owns a lock-free deque; handles scheduled from a worker go to its
+// own deque, handles scheduled from outside go to a shared injection queue, and
+// idle workers steal from random victims before going to sleep.
+// Every deque and the injection queue exist once per priority lane.
 class executor {
 public:
     explicit executor(size_t thread_count = std::thread::hardware_concurrency());
+    explicit executor(const executor_config& config);
     ~executor();
 
     // Submit a coroutine handle to the execution queue
-    void schedule(std::coroutine_handle<> handle);
+    void schedule(std::coroutine_handle<> handle, priority lane = priority::normal);
+
+    // Submit a batch with one queue operation and wake only as many sleeping
+    // workers as there are handles; idle workers spread the batch by stealing
+    void schedule_bulk(std::span<const std::coroutine_handle<>> handles, priority lane = priority::normal);
+
+    // Queue behind the work already waiting: always goes through the
+    // injection queue, so a worker's LIFO pop does not pick it right back up
+    void schedule_later(std::coroutine_handle<> handle, priority lane = priority::normal);
     
     // Stop the executor
     void shutdown();
     
-    // Get the number of pending tasks
+    // Get the number of pending tasks (approximate while workers are running)
     size_t pending_tasks() const;
 
+    // Snapshot of per-worker counters and the schedule latency histogram
+    executor_stats stats() const;
+
+    // Number of worker threads
+    size_t thread_count() const noexcept { return workers_.size(); }
+
+    // executor_config::name, empty for an anonymous executor
+    const std::string& name() const noexcept { return name_; }
+
+    // Timer service shared by every delay on this executor
+    timer_wheel& timers() noexcept { return timers_; }
+
+    // Executor owning the calling worker thread, or nullptr off-pool
+    static executor* current() noexcept;
+
+    // For work buffered per thread (io_uring submissions): on a worker,
+    // flush() runs once the current resume batch ends, i.e. when the worker
+    // runs out of local work or after batch_flush_interval resumes. Returns
+    // false off-pool (or if another flush is pending), and the caller has to
+    // flush right away.
+    static bool flush_after_batch(void (*flush)()) noexcept;
+
+    // Handles queued on the calling worker's own deques (0 off-pool). A
+    // thief-visible backlog: while it is non-zero, idle workers have
+    // something to steal, so a producer need not split off more.
+    static size_t local_queue_depth() noexcept;
+
+    // Admission control for new work (not continuations): queue `handle`
+    // through the bounded injection queue, or return false when it is full
+    // or the executor is stopped so the caller can shed load
+    bool try_schedule(std::coroutine_handle<> handle);
+
+    // co_await exec.submit(handle): like try_schedule(), but suspends the
+    // caller until the queue has room instead of failing. Yields false if the
+    // executor stopped first; handle was not queued and the caller owns it.
+    submit_awaiter submit(std::coroutine_handle<> handle);
+
 private:
-    void worker_thread();
+    friend struct submit_awaiter;
+
+    // Written only by the owning worker (relaxed), read by stats()
+    struct alignas(64) worker_counters {
+        std::atomic<uint64_t> tasks_resumed{0};
+        std::atomic<uint64_t> high_priority_resumed{0};
+        std::atomic<uint64_t> steals{0};
+        std::atomic<uint64_t> injected{0};
+        std::atomic<uint64_t> parks{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> idle_ns{0};
+        std::atomic<size_t> queue_high_water{0};
+        std::array<std::atomic<uint64_t>, latency_histogram::bucket_count> latency{};
+        std::atomic<uint64_t> latency_sum{0};
+        std::atomic<uint64_t> latency_max{0};
+    };
+
+    static constexpr size_t lane_count = 2;
+
+    struct worker {
+        std::array<work_stealing_deque, lane_count> local;
+        std::thread thread;
+        size_t node = 0;        // Index into nodes_
+        std::vector<int> cpus;  // Affinity set, empty when not restricted
+        worker_counters counters;
+
+        // 1 while parked; whoever flips it back to 0 owns the wakeup
+        alignas(64) std::atomic<uint32_t> sleeping{0};
+    };
+
+    // Work submitted from threads that are not workers of this executor,
+    // one per NUMA node so outside wakeups stay near where they came from
+    struct alignas(64) injection_queue {
+        std::mutex mutex;
+        std::array<std::queue<std::coroutine_handle<>>, lane_count> queues;
+        std::array<std::atomic<size_t>, lane_count> count{};
+    };
+
+    struct node_group {
+        int id = 0;                   // NUMA node id
+        std::vector<size_t> workers;  // Worker indices on this node
+        injection_queue injection;
+    };
+
+    // A sampled schedule() waiting for its resume; `handle` is the key
+    struct latency_probe {
+        std::atomic<void*> handle{nullptr};
+        std::atomic<uint64_t> scheduled_ns{0};
+    };
+
+    static constexpr uint64_t latency_sample_interval = 64;
+
+    // A worker with a never-empty deque still polls the injection queue (timer
+    // and I/O wakeups) at least once per this many local resumes, and moves up
+    // to injection_batch handles at a time onto its deque
+    static constexpr uint32_t injection_poll_interval = 61;
+    static constexpr size_t injection_batch = 32;
+
+    // While both lanes have work, at most this many high priority handles run
+    // in a row before a normal one, so normal keeps at least 1/9 of pickups
+    static constexpr uint32_t high_priority_burst = 8;
+
+    // Longest run of resumes before a flush_after_batch() callback runs
+    static constexpr uint32_t batch_flush_interval = 32;
+    static constexpr size_t latency_probe_count = 256;
+
+    void sample_schedule(std::coroutine_handle<> handle);
+    void sample_resume(worker_counters& counters, std::coroutine_handle<> handle);
+
+    void worker_thread(size_t index);
+    std::coroutine_handle<> find_work(size_t index, size_t lane, uint64_t& rng, bool poll_injection);
+    std::coroutine_handle<> take_injected(worker& self, size_t lane, injection_queue& injection);
+    std::coroutine_handle<> steal_work(size_t self, size_t lane, uint64_t& rng);
+    size_t caller_node() const noexcept;
+    void place_workers(const executor_config& config);
+    bool has_visible_work() const;
+    bool idle(worker& self, uint32_t& spin_budget);
+    bool park(worker& self);
+    bool wake_sleeper(worker& w);
+    void wake_one();
+    void wake_many(size_t count);
+    bool push_submission(std::coroutine_handle<> handle);
+    std::coroutine_handle<> take_submitted();
+    void admit_submitters();
+    bool wait_for_room(submit_awaiter& waiter);
     
-    std::vector<std::thread> workers_;
-    std::queue<std::coroutine_handle<>> task_queue_;
-    mutable std::mutex mutex_;
-    std::condition_variable cv_;
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::vector<std::unique_ptr<node_group>> nodes_;
+    std::vector<int> node_index_of_id_;  // NUMA node id -> index into nodes_, -1 if unused
+
+    // High priority handles queued anywhere; lets workers skip the high lane
+    // with a single load while it is empty
+    std::atomic<size_t> high_pending_{0};
+
+    // Bounded queue behind submit()/try_schedule(), null when unbounded, and
+    // the producers suspended in submit() waiting for room (FIFO)
+    std::unique_ptr<bounded_mpmc_queue<std::coroutine_handle<>>> submissions_;
+    std::mutex submit_mutex_;
+    submit_awaiter* submit_head_ = nullptr;
+    submit_awaiter* submit_tail_ = nullptr;
+    std::atomic<size_t> submit_waiting_{0};
+    std::atomic<uint64_t> rejected_{0};
+
+    std::string name_;
+
+    // Parked workers; producers skip the wake scan while it is zero
+    std::atomic<size_t> sleepers_{0};
+    idle_policy idle_;
+
     std::atomic<bool> stopped_{false};
+
+    std::array<latency_probe, latency_probe_count> probes_{};
+
+    timer_wheel timers_;
+};
+
+// Awaitable returned by executor::submit()
+struct submit_awaiter {
+    executor& exec_;
+    std::coroutine_handle<> handle_;
+    std::coroutine_handle<> producer_ = nullptr;
+    executor* producer_exec_ = nullptr;  // Where the producer is resumed
+    submit_awaiter* next_ = nullptr;
+    bool queued_ = true;
+
+    bool await_ready() { return exec_.push_submission(handle_); }
+
+    bool await_suspend(std::coroutine_handle<> producer);
+
+    bool await_resume() noexcept { return queued_; }
 };
 
-// Global executor instance
-inline executor& get_global_executor() {
-    static executor exec(4);  // 4 worker threads
-    return exec;
+inline submit_awaiter executor::submit(std::coroutine_handle<> handle) {
+    return submit_awaiter{*this, handle};
+}
+
+// Global executor instance, created on first use
+// Named "global", 4 worker threads and a 4096-slot submit() queue unless
+// configure_global_executor() said otherwise; the TASK_DO_THREADS
+// environment variable overrides the thread count (0 = one per CPU)
+executor& get_global_executor();
+
+// Replace the global executor's configuration; throws std::logic_error once
+// get_global_executor() has been called
+void configure_global_executor(const executor_config& config);
+
+// Create an executor that lives until exit and can be looked up by
+// config.name; throws std::invalid_argument if the name is empty or taken
+executor& make_executor(const executor_config& config);
+
+// Executor registered under `name` ("global" is the global executor), or
+// nullptr if there is none
+executor* find_executor(std::string_view name);
+
+// Executor the calling coroutine runs on, or the global one off-pool
+// Library awaitables resume here, so work stays on the pool it started on
+inline executor& current_executor() {
+    executor* exec = executor::current();
+    return exec ? *exec : get_global_executor();
+}
+
+inline bool submit_awaiter::await_suspend(std::coroutine_handle<> producer) {
+    producer_ = producer;
+    producer_exec_ = &current_executor();
+    return exec_.wait_for_room(*this);
 }
 
 // Awaitable type for switching to executor thread in coroutine
+// Completes synchronously when the coroutine already runs on one of the
+// executor's workers; use yield() to force a trip through the queue
 struct schedule_awaiter {
     executor& exec_;
+    priority lane_;
     
-    explicit schedule_awaiter(executor& exec) : exec_(exec) {}
+    explicit schedule_awaiter(executor& exec, priority lane = priority::normal)
+        : exec_(exec), lane_(lane) {}
     
-    bool await_ready() const noexcept { return false; }
+    bool await_ready() const noexcept { return executor::current() == &exec_; }
     
     void await_suspend(std::coroutine_handle<> handle) {
-        exec_.schedule(handle);
+        exec_.schedule(handle, lane_);
     }
     
     void await_resume() noexcept {}
 };
 
 // Helper function: schedule current coroutine on executor
-inline schedule_awaiter schedule_on(executor& exec) {
-    return schedule_awaiter{exec};
+inline schedule_awaiter schedule_on(executor& exec, priority lane = priority::normal) {
+    return schedule_awaiter{exec, lane};
 }
 
-// Simulate async operation: delayed execution
-struct delay_awaiter {
+// Awaitable that always requeues the coroutine behind already queued work
+// (on the current executor, or the global one when called off-pool)
+struct yield_awaiter {
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        current_executor().schedule_later(handle);
+    }
+
+    void await_resume() noexcept {}
+};
+
+// Helper function: let other queued coroutines run before continuing
+inline yield_awaiter yield() {
+    return {};
+}
+
+// Async delay: arms a timer on the current executor's timer wheel instead of
+// sleeping a thread, and resumes the coroutine on that executor when it fires
+struct delay_awaiter : timer_node {
     std::chrono::milliseconds duration_;
+    std::coroutine_handle<> handle_;
+    executor* exec_ = nullptr;
     
     explicit delay_awaiter(std::chrono::milliseconds duration) 
         : duration_(duration) {}
     
-    bool await_ready() const noexcept { return duration_.count() == 0; }
+    bool await_ready() const noexcept { return duration_.count() <= 0; }
     
     void await_suspend(std::coroutine_handle<> handle) {
-        std::thread([handle, duration = duration_]() {
-            std::this_thread::sleep_for(duration);
-            get_global_executor().schedule(handle);
-        }).detach();
+        handle_ = handle;
+        exec_ = &current_executor();
+        callback = [](timer_node& node) {
+            auto& self = static_cast<delay_awaiter&>(node);
+            self.exec_->schedule(self.handle_);
+        };
+        exec_->timers().arm(*this, duration_);
     }
     
     void await_resume() noexcept {}
@@ -97,103 +384,23 @@ inline delay_awaiter async_delay(std::chrono::milliseconds ms) {
 
 // Forward declarations for sync_wait
 template<typename T>
-T sync_wait_impl(task<T>&& t, std::false_type);
+T sync_wait_impl(task<T>&& t, std::false_type, executor& exec);
 
-void sync_wait_impl(task<void>&& t, std::true_type);
+void sync_wait_impl(task<void>&& t, std::true_type, executor& exec);
 
 template<typename T>
 auto sync_wait(task<T>&& t) -> T;
 
+template<typename T>
+auto sync_wait(task<T>&& t, executor& exec) -> T;
+
 // Run a coroutine directly on the executor (fire and forget)
+// The caller's executor when called from a worker, else the global one; the
+// frame frees itself when the coroutine finishes
 // Warning: Exceptions will be silently ignored
 template<typename Task>
 void async_run(Task&& t) {
-    auto wrapper = [](Task t) -> void {
-        try {
-            auto awaiter = std::move(t).operator co_await();
-            auto handle = awaiter.await_suspend(std::noop_coroutine());
-            get_global_executor().schedule(handle);
-        } catch (const std::exception& e) {
-            std::fprintf(stderr, "[async_run] Exception during task launch: %s\n", e.what());
-        } catch (...) {
-            std::fprintf(stderr, "[async_run] Unknown exception during task launch\n");
-        }
-    };
-    
-    std::thread(wrapper, std::forward<Task>(t)).detach();
-}
-
-// Run a coroutine on the executor and get a future-like handle
-class async_result {
-public:
-    async_result() : completed_(false), result_(0) {}
-    
-    void set_result(int value) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            result_ = value;
-            completed_ = true;
-        }
-        cv_.notify_all();
-    }
-    
-    void set_exception(std::exception_ptr ex) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            exception_ = ex;
-            completed_ = true;
-        }
-        cv_.notify_all();
-    }
-    
-    int get() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        cv_.wait(lock, [this] { return completed_; });
-        
-        if (exception_) {
-            std::rethrow_exception(exception_);
-        }
-        
-        return result_;
-    }
-    
-    bool is_ready() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return completed_;
-    }
-
-private:
-    mutable std::mutex mutex_;
-    std::condition_variable cv_;
-    bool completed_;  // Changed from atomic to regular bool protected by mutex
-    int result_;
-    std::exception_ptr exception_;
-};
-
-// Run a coroutine and return a handle to get the result later
-template<typename Task>
-std::shared_ptr<async_result> async_spawn(Task&& t) {
-    auto result = std::make_shared<async_result>();
-    
-    auto wrapper = [](Task t, std::shared_ptr<async_result> result) -> void {
-        try {
-            auto awaiter = std::move(t).operator co_await();
-            auto handle = awaiter.await_suspend(std::noop_coroutine());
-            get_global_executor().schedule(handle);
-            
-            while (!handle.done()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            }
-            
-            int value = awaiter.await_resume();
-            result->set_result(value);
-        } catch (...) {
-            result->set_exception(std::current_exception());
-        }
-    };
-    
-    std::thread(wrapper, std::forward<Task>(t), result).detach();
-    return result;
+    current_executor().schedule(std::forward<Task>(t).release_detached());
 }
 
 #endif //TASK_DO_EXECUTOR_H
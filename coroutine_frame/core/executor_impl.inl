@@ -5,79 +5,113 @@
 #ifndef TASK_DO_EXECUTOR_IMPL_INL
 #define TASK_DO_EXECUTOR_IMPL_INL
 
-#include <thread>
 #include <atomic>
+#include <coroutine>
+#include <cstdint>
 #include <exception>
+#include <memory>
+#include <optional>
+#include <variant>
+#include <type_traits>
 
-// Helper for non-void sync_wait
+namespace detail {
+
+// Result slot plus a one-shot latch the sync_wait caller blocks on
+// (std::atomic::wait is a futex on Linux, so wakeup is immediate). Shared
+// between caller and driver: the caller may return as soon as it sees done,
+// while set() is still inside notify_one().
 template<typename T>
-T sync_wait_impl(task<T>&& t, std::false_type /* is_void */) {
-    std::atomic<bool> completed{false};
-    T result{};
+struct sync_wait_state {
+    std::atomic<uint32_t> done{0};
     std::exception_ptr exception;
-    
-    auto wrapper = [](task<T> task_obj, std::atomic<bool>& completed, T& result, std::exception_ptr& exception) -> void {
-        try {
-            auto awaiter = std::move(task_obj).operator co_await();
-            auto handle = awaiter.await_suspend(std::noop_coroutine());
-            get_global_executor().schedule(handle);
-            
-            while (!handle.done()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            }
-            
-            result = awaiter.await_resume();
-        } catch (...) {
-            exception = std::current_exception();
+    std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>> value;
+
+    void set() noexcept {
+        done.store(1, std::memory_order_release);
+        done.notify_one();
+    }
+
+    void wait() noexcept {
+        while (done.load(std::memory_order_acquire) == 0) {
+            done.wait(0, std::memory_order_acquire);
         }
-        completed = true;
-    };
-    
-    std::thread worker(wrapper, std::move(t), std::ref(completed), std::ref(result), std::ref(exception));
-    worker.join();
-    
-    if (exception) {
-        std::rethrow_exception(exception);
     }
-    
-    return result;
-}
+};
 
-// Helper for void sync_wait
-inline void sync_wait_impl(task<void>&& t, std::true_type /* is_void */) {
-    std::atomic<bool> completed{false};
-    std::exception_ptr exception;
-    
-    auto wrapper = [](task<void> task_obj, std::atomic<bool>& completed, std::exception_ptr& exception) -> void {
-        try {
-            auto awaiter = std::move(task_obj).operator co_await();
-            auto handle = awaiter.await_suspend(std::noop_coroutine());
-            get_global_executor().schedule(handle);
-            
-            while (!handle.done()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            }
-            
-            awaiter.await_resume();
-        } catch (...) {
-            exception = std::current_exception();
+// Driver coroutine: awaits the task on the executor, stores the outcome, and
+// releases the latch while its frame is being destroyed, so the caller never
+// races with the worker over the frame
+template<typename T>
+struct sync_wait_driver {
+    struct promise_type {
+        std::shared_ptr<sync_wait_state<T>> state_;  // Dropped after set()
+
+        ~promise_type() {
+            state_->set();
+        }
+
+        sync_wait_driver get_return_object() noexcept {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
         }
-        completed = true;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { state_->exception = std::current_exception(); }
     };
-    
-    std::thread worker(wrapper, std::move(t), std::ref(completed), std::ref(exception));
-    worker.join();
-    
-    if (exception) {
-        std::rethrow_exception(exception);
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template<typename T>
+sync_wait_driver<T> make_sync_wait_driver(task<T> t, sync_wait_state<T>& state) {
+    if constexpr (std::is_void_v<T>) {
+        co_await std::move(t);
+    } else {
+        state.value.emplace(co_await std::move(t));
     }
 }
 
+template<typename T>
+std::shared_ptr<sync_wait_state<T>> run_sync_wait(task<T>&& t, executor& exec) {
+    auto state = std::make_shared<sync_wait_state<T>>();
+    auto driver = make_sync_wait_driver<T>(std::move(t), *state);
+    driver.handle_.promise().state_ = state;
+    exec.schedule(driver.handle_);
+    state->wait();
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+    return state;
+}
+
+} // namespace detail
+
+// Helper for non-void sync_wait
+template<typename T>
+T sync_wait_impl(task<T>&& t, std::false_type /* is_void */, executor& exec) {
+    auto state = detail::run_sync_wait(std::move(t), exec);
+    return std::move(*state->value);
+}
+
+// Helper for void sync_wait
+inline void sync_wait_impl(task<void>&& t, std::true_type /* is_void */, executor& exec) {
+    detail::run_sync_wait(std::move(t), exec);
+}
+
 // Synchronously wait for a task to complete
 // Exceptions from the task will be re-thrown to the caller
+// Must not be called from an executor worker thread
 template<typename T>
 auto sync_wait(task<T>&& t) -> T {
-    return sync_wait_impl(std::move(t), std::is_void<T>{});
+    return sync_wait_impl(std::move(t), std::is_void<T>{}, current_executor());
+}
+
+// Same, starting the task on `exec` instead of the global executor
+template<typename T>
+auto sync_wait(task<T>&& t, executor& exec) -> T {
+    return sync_wait_impl(std::move(t), std::is_void<T>{}, exec);
 }
 
 #endif // TASK_DO_EXECUTOR_IMPL_INL
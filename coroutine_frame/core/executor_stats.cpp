@@ -0,0 +1,202 @@
+#include "executor_stats.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <sstream>
+
+size_t latency_histogram::bucket_for(uint64_t value) noexcept {
+    constexpr uint64_t sub_buckets = uint64_t{1} << sub_bucket_bits;
+    if (value < sub_buckets) {
+        return static_cast<size_t>(value);  // Exact below 16
+    }
+    unsigned msb = 63 - static_cast<unsigned>(std::countl_zero(value));
+    unsigned group = msb - sub_bucket_bits + 1;
+    if (group > max_exponent) {
+        return bucket_count - 1;
+    }
+    uint64_t sub = (value >> (msb - sub_bucket_bits)) & (sub_buckets - 1);
+    return (static_cast<size_t>(group) << sub_bucket_bits) | static_cast<size_t>(sub);
+}
+
+uint64_t latency_histogram::bucket_upper_bound(size_t index) noexcept {
+    size_t group = index >> sub_bucket_bits;
+    uint64_t sub = index & ((size_t{1} << sub_bucket_bits) - 1);
+    if (group == 0) {
+        return sub;
+    }
+    unsigned msb = static_cast<unsigned>(group) + sub_bucket_bits - 1;
+    unsigned width_bits = msb - sub_bucket_bits;
+    uint64_t lower = (uint64_t{1} << msb) + (sub << width_bits);
+    return lower + (uint64_t{1} << width_bits) - 1;
+}
+
+void latency_histogram::record(uint64_t value) noexcept {
+    add(bucket_for(value), 1);
+    add_totals(value, value);
+}
+
+void latency_histogram::add(size_t bucket, uint64_t n) noexcept {
+    counts_[bucket] += n;
+    count_ += n;
+}
+
+void latency_histogram::add_totals(uint64_t sum, uint64_t max) noexcept {
+    sum_ += sum;
+    max_ = std::max(max_, max);
+}
+
+void latency_histogram::merge(const latency_histogram& other) noexcept {
+    for (size_t i = 0; i < bucket_count; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    add_totals(other.sum_, other.max_);
+}
+
+uint64_t latency_histogram::percentile(double q) const noexcept {
+    if (count_ == 0) {
+        return 0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count_))));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            return std::min(bucket_upper_bound(i), max_);
+        }
+    }
+    return max_;
+}
+
+worker_stats executor_stats::total() const {
+    worker_stats sum;
+    for (const auto& w : workers) {
+        sum.tasks_resumed += w.tasks_resumed;
+        sum.high_priority_resumed += w.high_priority_resumed;
+        sum.steals += w.steals;
+        sum.injected += w.injected;
+        sum.parks += w.parks;
+        sum.busy_ns += w.busy_ns;
+        sum.idle_ns += w.idle_ns;
+        sum.queue_high_water = std::max(sum.queue_high_water, w.queue_high_water);
+        sum.schedule_latency.merge(w.schedule_latency);
+    }
+    return sum;
+}
+
+namespace {
+    constexpr double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    // Prometheus buckets: le = 2^k - 1 ns for k in [7, 34] (127ns to ~17s).
+    // Each is the exact upper bound of an HDR bucket, so the counts are exact
+    constexpr unsigned prometheus_first_bit = 7;
+    constexpr unsigned prometheus_last_bit = 34;
+
+    // Shortest text that reads back as the same double
+    std::string seconds(uint64_t ns) {
+        char buf[32];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), static_cast<double>(ns) / 1e9);
+        return std::string(buf, end);
+    }
+    constexpr const char* quantile_names[] = {"p50", "p90", "p99", "p999"};
+
+    void write_latency_json(std::ostringstream& out, const latency_histogram& h) {
+        out << "{\"count\":" << h.count();
+        for (size_t i = 0; i < std::size(quantiles); ++i) {
+            out << ",\"" << quantile_names[i] << "_ns\":" << h.percentile(quantiles[i]);
+        }
+        out << ",\"max_ns\":" << h.max() << "}";
+    }
+
+    void write_worker_json(std::ostringstream& out, const worker_stats& w) {
+        out << "{\"tasks_resumed\":" << w.tasks_resumed
+            << ",\"high_priority_resumed\":" << w.high_priority_resumed
+            << ",\"steals\":" << w.steals
+            << ",\"injected\":" << w.injected
+            << ",\"parks\":" << w.parks
+            << ",\"busy_ns\":" << w.busy_ns
+            << ",\"idle_ns\":" << w.idle_ns
+            << ",\"queue_high_water\":" << w.queue_high_water
+            << ",\"schedule_latency\":";
+        write_latency_json(out, w.schedule_latency);
+        out << "}";
+    }
+}
+
+std::string executor_stats::to_json() const {
+    std::ostringstream out;
+    out << "{\"pending_tasks\":" << pending_tasks
+        << ",\"latency_sample_interval\":" << latency_sample_interval
+        << ",\"rejected_submissions\":" << rejected_submissions
+        << ",\"total\":";
+    write_worker_json(out, total());
+    out << ",\"workers\":[";
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (i > 0) {
+            out << ",";
+        }
+        write_worker_json(out, workers[i]);
+    }
+    out << "]}";
+    return out.str();
+}
+
+std::string executor_stats::to_prometheus(std::string_view prefix) const {
+    std::ostringstream out;
+    std::string p(prefix);
+
+    auto counter = [&](const char* name, const char* help, auto field) {
+        out << "# HELP " << p << "_" << name << " " << help << "\n"
+            << "# TYPE " << p << "_" << name << " counter\n";
+        for (const auto& w : workers) {
+            out << p << "_" << name << "{worker=\"" << w.index << "\"} " << field(w) << "\n";
+        }
+    };
+
+    counter("tasks_resumed_total", "Coroutines resumed", [](const worker_stats& w) { return w.tasks_resumed; });
+    counter("high_priority_resumed_total", "Coroutines resumed from the high priority lane",
+            [](const worker_stats& w) { return w.high_priority_resumed; });
+    counter("steals_total", "Handles stolen from other workers", [](const worker_stats& w) { return w.steals; });
+    counter("injected_total", "Handles taken from the injection queue", [](const worker_stats& w) { return w.injected; });
+    counter("parks_total", "Times a worker went to sleep", [](const worker_stats& w) { return w.parks; });
+    counter("busy_seconds_total", "Time awake", [](const worker_stats& w) { return seconds(w.busy_ns); });
+    counter("idle_seconds_total", "Time parked", [](const worker_stats& w) { return seconds(w.idle_ns); });
+
+    out << "# HELP " << p << "_queue_high_water Deepest local queue seen\n"
+        << "# TYPE " << p << "_queue_high_water gauge\n";
+    for (const auto& w : workers) {
+        out << p << "_queue_high_water{worker=\"" << w.index << "\"} " << w.queue_high_water << "\n";
+    }
+
+    out << "# HELP " << p << "_pending_tasks Handles queued but not yet resumed\n"
+        << "# TYPE " << p << "_pending_tasks gauge\n"
+        << p << "_pending_tasks " << pending_tasks << "\n";
+
+    out << "# HELP " << p << "_rejected_submissions_total try_schedule() calls refused by a full queue\n"
+        << "# TYPE " << p << "_rejected_submissions_total counter\n"
+        << p << "_rejected_submissions_total " << rejected_submissions << "\n";
+
+    // Cumulative buckets in seconds, the same set on every scrape
+    latency_histogram latency = total().schedule_latency;
+    std::string name = p + "_schedule_latency_seconds";
+    out << "# HELP " << name << " Sampled delay from schedule() to resume()\n"
+        << "# TYPE " << name << " histogram\n";
+    uint64_t cumulative = 0;
+    size_t next = 0;
+    const auto& buckets = latency.buckets();
+    for (unsigned bit = prometheus_first_bit; bit <= prometheus_last_bit; ++bit) {
+        uint64_t bound = (uint64_t{1} << bit) - 1;
+        for (size_t last = latency_histogram::bucket_for(bound); next <= last; ++next) {
+            cumulative += buckets[next];
+        }
+        out << name << "_bucket{le=\"" << seconds(bound) << "\"} " << cumulative << "\n";
+    }
+    out << name << "_bucket{le=\"+Inf\"} " << latency.count() << "\n"
+        << name << "_sum " << seconds(latency.sum()) << "\n"
+        << name << "_count " << latency.count() << "\n";
+
+    return out.str();
+}
@@ -0,0 +1,76 @@
+#ifndef TASK_DO_EXECUTOR_STATS_H
+#define TASK_DO_EXECUTOR_STATS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HDR-style log-linear histogram of nanosecond values
+// Each power of two is split into 16 linear sub-buckets, so any recorded
+// value is reported with at most ~6% relative error, from 1ns up to ~18min.
+class latency_histogram {
+public:
+    static constexpr unsigned sub_bucket_bits = 4;
+    static constexpr unsigned max_exponent = 40;
+    static constexpr size_t bucket_count = (max_exponent + 1) << sub_bucket_bits;
+
+    static size_t bucket_for(uint64_t value) noexcept;
+
+    // Largest value that falls into bucket `index`
+    static uint64_t bucket_upper_bound(size_t index) noexcept;
+
+    void record(uint64_t value) noexcept;
+    void merge(const latency_histogram& other) noexcept;
+
+    // Bulk-load counts gathered elsewhere; sum and max are added separately
+    void add(size_t bucket, uint64_t n) noexcept;
+    void add_totals(uint64_t sum, uint64_t max) noexcept;
+
+    uint64_t count() const noexcept { return count_; }
+    uint64_t sum() const noexcept { return sum_; }
+    uint64_t max() const noexcept { return max_; }
+
+    // Value at quantile q in [0, 1] (upper bound of its bucket), 0 if empty
+    uint64_t percentile(double q) const noexcept;
+
+    const std::array<uint64_t, bucket_count>& buckets() const noexcept { return counts_; }
+
+private:
+    std::array<uint64_t, bucket_count> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Counters of one worker thread at the time of the snapshot
+struct worker_stats {
+    size_t index = 0;
+    uint64_t tasks_resumed = 0;
+    uint64_t high_priority_resumed = 0;  // ... from the high priority lane
+    uint64_t steals = 0;             // Handles taken from other workers' deques
+    uint64_t injected = 0;           // Handles taken from the injection queue
+    uint64_t parks = 0;              // Times the worker went to sleep
+    uint64_t busy_ns = 0;            // Awake: running or looking for work
+    uint64_t idle_ns = 0;            // Parked
+    size_t queue_high_water = 0;     // Deepest the local deque has been
+    latency_histogram schedule_latency;  // Sampled schedule() -> resume() delay
+};
+
+// Snapshot returned by executor::stats()
+struct executor_stats {
+    std::vector<worker_stats> workers;
+    size_t pending_tasks = 0;
+    uint64_t latency_sample_interval = 0;  // One schedule() in N is timed
+    uint64_t rejected_submissions = 0;     // try_schedule() calls that found the queue full
+
+    // Per-worker counters summed, histograms merged
+    worker_stats total() const;
+
+    std::string to_json() const;
+    std::string to_prometheus(std::string_view prefix = "task_do_executor") const;
+};
+
+#endif //TASK_DO_EXECUTOR_STATS_H
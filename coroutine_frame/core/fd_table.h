@@ -0,0 +1,59 @@
+#ifndef TASK_DO_FD_TABLE_H
+#define TASK_DO_FD_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Per-file-descriptor state indexed by fd number
+// Entries are allocated a chunk at a time and never freed until the table is
+// destroyed, so lookups are lock-free and a reference stays valid even while
+// another thread closes (and the kernel reuses) the fd. The table covers fds
+// below capacity; callers check contains() before indexing.
+template<typename T, size_t ChunkBits = 10, size_t MaxChunks = 1024>
+class fd_table {
+public:
+    fd_table() = default;
+    fd_table(const fd_table&) = delete;
+    fd_table& operator=(const fd_table&) = delete;
+
+    ~fd_table() {
+        for (auto& slot : chunks_) {
+            delete slot.load(std::memory_order_relaxed);
+        }
+    }
+
+    static constexpr size_t capacity = MaxChunks << ChunkBits;
+
+    static bool contains(int fd) noexcept {
+        return fd >= 0 && static_cast<size_t>(fd) < capacity;
+    }
+
+    // fd must satisfy contains()
+    T& operator[](int fd) {
+        size_t index = static_cast<size_t>(fd);
+        auto& slot = chunks_[index >> ChunkBits];
+
+        chunk* c = slot.load(std::memory_order_acquire);
+        if (!c) {
+            auto* fresh = new chunk();
+            if (slot.compare_exchange_strong(c, fresh, std::memory_order_acq_rel)) {
+                c = fresh;
+            } else {
+                delete fresh;  // Another thread installed it first
+            }
+        }
+        return c->items[index & (chunk_size - 1)];
+    }
+
+private:
+    static constexpr size_t chunk_size = size_t{1} << ChunkBits;
+
+    struct chunk {
+        std::array<T, chunk_size> items;
+    };
+
+    std::array<std::atomic<chunk*>, MaxChunks> chunks_{};
+};
+
+#endif //TASK_DO_FD_TABLE_H
@@ -0,0 +1,272 @@
+#include "frame_allocator.h"
+#include "cpu_topology.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+    constexpr size_t class_granularity = 64;
+    constexpr size_t num_classes = 64;            // Blocks of 64 .. 4096 bytes
+    constexpr size_t slab_bytes = 32 * 1024;      // Fresh blocks are carved from slabs
+    constexpr size_t batch_size = 32;             // Remote frees handed back per push
+    constexpr size_t outbox_slots = 8;            // Owners batched at once per thread
+    constexpr uint32_t oversized = UINT32_MAX;
+
+    struct thread_cache;
+
+    // Precedes every frame; keeps the frame 16-byte aligned
+    struct block_header {
+        thread_cache* owner;
+        uint32_t size_class;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(block_header) == 16);
+
+    // While a block is free its frame area holds the list link
+    block_header*& next_of(block_header* b) {
+        return *reinterpret_cast<block_header**>(b + 1);
+    }
+
+    // Remote frees waiting to go back to one owner
+    struct outgoing_batch {
+        thread_cache* owner = nullptr;
+        block_header* head = nullptr;
+        block_header* tail = nullptr;
+        size_t count = 0;
+    };
+
+    struct alignas(64) thread_cache {
+        // NUMA node of the thread that created it; slabs were first touched there
+        int node = 0;
+
+        // Touched only by the thread the cache is bound to
+        std::array<block_header*, num_classes> free_lists{};
+        std::array<char*, num_classes> bump{};
+        std::array<char*, num_classes> bump_end{};
+        std::array<outgoing_batch, outbox_slots> outbox{};
+
+        // Single writer (the bound thread), read by stats()
+        std::atomic<uint64_t> frames_allocated{0};
+        std::atomic<uint64_t> frames_recycled{0};
+        std::atomic<uint64_t> frames_freed{0};
+        std::atomic<uint64_t> remote_frees{0};
+        std::atomic<uint64_t> heap_allocations{0};
+
+        // Frames handed back by other threads (lock-free stack)
+        alignas(64) std::atomic<block_header*> inbox{nullptr};
+    };
+
+    // Only one thread writes each counter, so no locked RMW is needed
+    void bump_counter(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Every cache ever created; caches are never destroyed
+    struct cache_registry {
+        std::mutex mutex;
+        std::vector<thread_cache*> all;
+        std::vector<thread_cache*> orphans;
+    };
+
+    cache_registry& registry() {
+        // Leaked on purpose: frames may be freed during static destruction
+        static auto* r = new cache_registry();
+        return *r;
+    }
+
+    void push_inbox(thread_cache* owner, block_header* head, block_header* tail) {
+        block_header* old = owner->inbox.load(std::memory_order_relaxed);
+        do {
+            next_of(tail) = old;
+        } while (!owner->inbox.compare_exchange_weak(old, head, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+    }
+
+    void flush_batch(outgoing_batch& batch) {
+        if (batch.count > 0) {
+            push_inbox(batch.owner, batch.head, batch.tail);
+        }
+        batch = outgoing_batch{};
+    }
+
+    // Move everything other threads handed back onto the local lists
+    void drain_inbox(thread_cache& c) {
+        block_header* b = c.inbox.exchange(nullptr, std::memory_order_acquire);
+        while (b) {
+            block_header* next = next_of(b);
+            next_of(b) = c.free_lists[b->size_class];
+            c.free_lists[b->size_class] = b;
+            b = next;
+        }
+    }
+
+    block_header* carve(thread_cache& c, uint32_t size_class) {
+        size_t block = (size_class + 1) * class_granularity;
+        if (static_cast<size_t>(c.bump_end[size_class] - c.bump[size_class]) < block) {
+            auto* slab = static_cast<char*>(::operator new(slab_bytes));
+            bump_counter(c.heap_allocations);
+            c.bump[size_class] = slab;
+            c.bump_end[size_class] = slab + slab_bytes;
+        }
+        auto* b = reinterpret_cast<block_header*>(c.bump[size_class]);
+        c.bump[size_class] += block;
+        return b;
+    }
+
+    // Binds a cache to the current thread, and orphans it at thread exit
+    struct cache_binding {
+        thread_cache* cache;
+
+        cache_binding();
+        ~cache_binding();
+    };
+
+    thread_local bool binding_destroyed = false;
+
+    // A new thread only adopts an orphan from its own NUMA node, so pooled
+    // frames stay in node-local memory
+    cache_binding::cache_binding() {
+        int node = cpu_topology::system().current_node();
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto it = std::find_if(r.orphans.rbegin(), r.orphans.rend(),
+                               [node](thread_cache* c) { return c->node == node; });
+        if (it != r.orphans.rend()) {
+            cache = *it;
+            r.orphans.erase(std::next(it).base());
+        } else {
+            cache = new thread_cache();
+            cache->node = node;
+            r.all.push_back(cache);
+        }
+    }
+
+    cache_binding::~cache_binding() {
+        for (auto& batch : cache->outbox) {
+            flush_batch(batch);
+        }
+        binding_destroyed = true;
+
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.orphans.push_back(cache);
+    }
+
+    // nullptr once the thread is tearing down its thread_locals
+    thread_cache* current_cache() {
+        if (binding_destroyed) {
+            return nullptr;
+        }
+        thread_local cache_binding binding;
+        return binding.cache;
+    }
+}
+
+void* frame_allocator::allocate(size_t size) {
+    size_t total = size + sizeof(block_header);
+    thread_cache* c = current_cache();
+
+    if (total > num_classes * class_granularity || !c) {
+        auto* b = static_cast<block_header*>(::operator new(total));
+        b->owner = c;
+        b->size_class = oversized;
+        if (c) {
+            bump_counter(c->frames_allocated);
+            bump_counter(c->heap_allocations);
+        }
+        return b + 1;
+    }
+
+    auto size_class = static_cast<uint32_t>((total - 1) / class_granularity);
+    block_header* b = c->free_lists[size_class];
+    if (!b) {
+        drain_inbox(*c);
+        b = c->free_lists[size_class];
+    }
+
+    if (b) {
+        c->free_lists[size_class] = next_of(b);
+        bump_counter(c->frames_recycled);
+    } else {
+        b = carve(*c, size_class);
+    }
+    bump_counter(c->frames_allocated);
+
+    b->owner = c;
+    b->size_class = size_class;
+    return b + 1;
+}
+
+void frame_allocator::deallocate(void* ptr, size_t size) noexcept {
+    if (!ptr) {
+        return;
+    }
+    block_header* b = static_cast<block_header*>(ptr) - 1;
+    thread_cache* c = current_cache();
+    if (c) {
+        bump_counter(c->frames_freed);
+    }
+
+    if (b->size_class == oversized) {
+        ::operator delete(b, size + sizeof(block_header));
+        return;
+    }
+
+    thread_cache* owner = b->owner;
+    if (owner == c) {
+        next_of(b) = c->free_lists[b->size_class];
+        c->free_lists[b->size_class] = b;
+        return;
+    }
+
+    if (!c) {
+        // Thread is exiting: hand the block back on its own
+        push_inbox(owner, b, b);
+        return;
+    }
+
+    bump_counter(c->remote_frees);
+
+    // Find this owner's batch, or claim a slot (evicting the first if full)
+    outgoing_batch* batch = nullptr;
+    for (auto& slot : c->outbox) {
+        if (slot.owner == owner) {
+            batch = &slot;
+            break;
+        }
+        if (!batch && slot.count == 0) {
+            batch = &slot;
+        }
+    }
+    if (!batch) {
+        batch = &c->outbox[0];
+        flush_batch(*batch);
+    }
+    if (batch->count == 0) {
+        batch->owner = owner;
+        batch->tail = b;
+    }
+    next_of(b) = batch->head;
+    batch->head = b;
+
+    if (++batch->count >= batch_size) {
+        flush_batch(*batch);
+    }
+}
+
+frame_allocator_stats frame_allocator::stats() {
+    frame_allocator_stats s;
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (thread_cache* c : r.all) {
+        s.frames_allocated += c->frames_allocated.load(std::memory_order_relaxed);
+        s.frames_recycled += c->frames_recycled.load(std::memory_order_relaxed);
+        s.frames_freed += c->frames_freed.load(std::memory_order_relaxed);
+        s.remote_frees += c->remote_frees.load(std::memory_order_relaxed);
+        s.heap_allocations += c->heap_allocations.load(std::memory_order_relaxed);
+    }
+    return s;
+}
@@ -0,0 +1,36 @@
+#ifndef TASK_DO_FRAME_ALLOCATOR_H
+#define TASK_DO_FRAME_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Counters summed over every thread cache
+// frames_allocated - frames_recycled frames came from fresh slab memory; in
+// steady state both that and heap_allocations stop growing.
+struct frame_allocator_stats {
+    uint64_t frames_allocated = 0;  // Frames handed out
+    uint64_t frames_recycled = 0;   // ... served from a free list
+    uint64_t frames_freed = 0;      // Frames given back
+    uint64_t remote_frees = 0;      // ... on a thread other than the allocating one
+    uint64_t heap_allocations = 0;  // Calls into ::operator new (slabs and oversized frames)
+};
+
+// Pooled allocator for coroutine frames
+//
+// Each thread owns a cache of size-class free lists (64-byte classes up to
+// 4KB; larger frames go straight to ::operator new). A frame freed on the
+// thread that allocated it goes back on that thread's list. A frame freed on
+// another thread is batched per owner and handed back to the owner's
+// lock-free inbox in groups, which the owner drains when a list runs dry.
+// Caches outlive their threads: a new thread adopts an orphaned cache from
+// its own NUMA node, so frames still in flight when a thread exits are never
+// leaked or dangling, and a pinned worker's pool stays in node-local memory.
+class frame_allocator {
+public:
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size) noexcept;
+
+    static frame_allocator_stats stats();
+};
+
+#endif //TASK_DO_FRAME_ALLOCATOR_H
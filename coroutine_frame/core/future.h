@@ -0,0 +1,222 @@
+#ifndef TASK_DO_FUTURE_H
+#define TASK_DO_FUTURE_H
+
+#include "task.h"
+#include "executor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace detail {
+    // Completion state shared by a spawned task and its future
+    // `waiter` goes from null to the awaiting coroutine (or straight to the
+    // ready tag); whoever swaps second knows the other side has arrived.
+    // Blocking waiters count themselves in `blocking` first, so completion
+    // only touches the mutex and condition variable when one exists.
+    struct future_state_base {
+        std::atomic<void*> waiter{nullptr};
+        executor* waiter_exec = nullptr;  // Where the awaiting coroutine resumes
+        std::exception_ptr exception;
+
+        // Blocking get() / wait_for() callers only
+        std::atomic<uint32_t> blocking{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        static void* ready_tag() noexcept { return reinterpret_cast<void*>(uintptr_t{1}); }
+
+        bool is_ready() const noexcept {
+            return waiter.load(std::memory_order_acquire) == ready_tag();
+        }
+
+        // Called once the result is stored; returns the coroutine to run next
+        std::coroutine_handle<> complete() noexcept {
+            // seq_cst on both sides: either a blocking waiter sees the ready
+            // tag, or we see its registration and notify it
+            void* w = waiter.exchange(ready_tag(), std::memory_order_seq_cst);
+            if (blocking.load(std::memory_order_seq_cst) > 0) {
+                // Taking the lock orders us after a waiter's predicate check
+                { std::lock_guard<std::mutex> lock(mutex); }
+                cv.notify_all();
+            }
+
+            if (!w) {
+                return std::noop_coroutine();
+            }
+            auto next = std::coroutine_handle<>::from_address(w);
+            if (waiter_exec != executor::current()) {
+                // Resume the waiter on its own pool, not the spawn's
+                waiter_exec->schedule(next);
+                return std::noop_coroutine();
+            }
+            return next;
+        }
+
+        // False if the result is already there and `h` should just continue
+        bool try_await(std::coroutine_handle<> h) noexcept {
+            waiter_exec = &current_executor();
+            void* expected = nullptr;
+            return waiter.compare_exchange_strong(expected, h.address(),
+                                                  std::memory_order_acq_rel, std::memory_order_acquire);
+        }
+
+        void wait() {
+            if (is_ready()) {
+                return;
+            }
+            blocking.fetch_add(1, std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return is_ready(); });
+            }
+            blocking.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        template<typename Rep, typename Period>
+        bool wait_for(std::chrono::duration<Rep, Period> timeout) {
+            if (is_ready()) {
+                return true;
+            }
+            blocking.fetch_add(1, std::memory_order_seq_cst);
+            bool ready;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready = cv.wait_for(lock, timeout, [this] { return is_ready(); });
+            }
+            blocking.fetch_sub(1, std::memory_order_relaxed);
+            return ready;
+        }
+    };
+
+    template<typename T>
+    struct future_state : future_state_base {
+        std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>> value;
+    };
+
+    // Runs the spawned task and publishes its outcome from final_suspend, after
+    // destroying its own frame, so a waiter never races with the frame
+    struct spawn_driver {
+        struct promise_type {
+            std::shared_ptr<future_state_base> state_;
+
+            struct final_awaiter {
+                bool await_ready() noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    std::shared_ptr<future_state_base> state = std::move(h.promise().state_);
+                    h.destroy();
+                    return state->complete();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            spawn_driver get_return_object() noexcept {
+                return spawn_driver{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            final_awaiter final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { state_->exception = std::current_exception(); }
+
+            static void* operator new(std::size_t size) {
+                return frame_allocator::allocate(size);
+            }
+
+            static void operator delete(void* ptr, std::size_t size) noexcept {
+                frame_allocator::deallocate(ptr, size);
+            }
+        };
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    template<typename T>
+    spawn_driver make_spawn_driver(task<T> t, future_state<T>& state) {
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(t);
+        } else {
+            state.value.emplace(co_await std::move(t));
+        }
+    }
+}
+
+// Result of async_spawn(): get() blocks, wait_for() blocks with a timeout,
+// and co_await suspends without blocking a thread. The result is moved out,
+// so read it once; at most one coroutine may co_await a future.
+// Dropping the future does not cancel the task.
+template<typename T>
+class future {
+public:
+    future() = default;
+    explicit future(std::shared_ptr<detail::future_state<T>> state) noexcept : state_(std::move(state)) {}
+
+    bool valid() const noexcept { return state_ != nullptr; }
+
+    bool is_ready() const noexcept { return state_->is_ready(); }
+
+    // Blocks the calling thread; do not call from an executor worker
+    void wait() const { state_->wait(); }
+
+    // False if the task is still running after `timeout`
+    template<typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> timeout) const {
+        return state_->wait_for(timeout);
+    }
+
+    // Blocks until the task finishes; rethrows its exception
+    T get() {
+        state_->wait();
+        return take();
+    }
+
+    struct awaiter {
+        future& future_;
+
+        bool await_ready() const noexcept { return future_.state_->is_ready(); }
+
+        bool await_suspend(std::coroutine_handle<> h) noexcept {
+            return future_.state_->try_await(h);
+        }
+
+        T await_resume() { return future_.take(); }
+    };
+
+    awaiter operator co_await() & noexcept { return awaiter{*this}; }
+    awaiter operator co_await() && noexcept { return awaiter{*this}; }
+
+private:
+    T take() {
+        if (state_->exception) {
+            std::rethrow_exception(state_->exception);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*state_->value);
+        }
+    }
+
+    std::shared_ptr<detail::future_state<T>> state_;
+};
+
+// Start `t` on the current executor (the global one off-pool) and return a
+// future for its result; no thread is created and nothing polls
+template<typename T>
+future<T> async_spawn(task<T> t) {
+    auto state = std::make_shared<detail::future_state<T>>();
+    auto driver = detail::make_spawn_driver<T>(std::move(t), *state);
+    driver.handle_.promise().state_ = state;
+    current_executor().schedule(driver.handle_);
+    return future<T>{std::move(state)};
+}
+
+#endif //TASK_DO_FUTURE_H
@@ -0,0 +1,357 @@
+#include "io_reactor.h"
+#include "io_uring_engine.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+io_reactor::io_reactor() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        std::fprintf(stderr, "[io_reactor] Failed to create epoll/eventfd: errno %d\n", errno);
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;  // nullptr marks the wakeup eventfd
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    thread_ = std::thread([this] { run(); });
+}
+
+io_reactor::~io_reactor() {
+    stop();
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+    }
+    if (epoll_fd_ >= 0) {
+        ::close(epoll_fd_);
+    }
+}
+
+void io_reactor::stop() {
+    if (stopped_.exchange(true)) {
+        return;
+    }
+    uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(wake_fd_, &one, sizeof(one));
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+// Called with st.mutex held
+void io_reactor::register_fd(int fd, fd_state& st) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0 && !(flags & O_NONBLOCK)) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &st;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0 && errno != EEXIST) {
+        std::fprintf(stderr, "[io_reactor] epoll_ctl ADD fd %d failed: errno %d\n", fd, errno);
+        return;
+    }
+
+    st.registered = true;
+}
+
+bool io_reactor::submit(io_op& op, direction dir) {
+    auto d = static_cast<size_t>(dir);
+    fd_state& st = states_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    if (op.cancelled.load(std::memory_order_acquire)) {
+        op.result = -ECANCELED;
+        return false;
+    }
+
+    // Register before the first attempt: accept() on a blocking listen
+    // socket would otherwise block the calling worker
+    if (!st.registered) {
+        register_fd(op.fd, st);
+        if (!st.registered) {
+            op.result = -EBADF;
+            return false;
+        }
+    }
+
+    // Nothing queued ahead of us: attempt the operation right away. If it
+    // would block, any later edge is handled by run_ready() under this lock.
+    if (!st.head[d] && op.perform(op)) {
+        return false;
+    }
+
+    op.next = nullptr;
+    if (st.tail[d]) {
+        st.tail[d]->next = &op;
+    } else {
+        st.head[d] = &op;
+    }
+    st.tail[d] = &op;
+    return true;
+}
+
+// Called with st.mutex held. Retries queued ops in order until one would
+// block; returns the completed ones chained through `next`.
+io_op* io_reactor::run_ready(fd_state& st, direction dir) {
+    auto d = static_cast<size_t>(dir);
+    io_op* done = nullptr;
+    io_op** done_tail = &done;
+    while (io_op* op = st.head[d]) {
+        if (!op->perform(*op)) {
+            break;
+        }
+        st.head[d] = op->next;
+        if (!st.head[d]) {
+            st.tail[d] = nullptr;
+        }
+        op->next = nullptr;
+        *done_tail = op;
+        done_tail = &op->next;
+    }
+    return done;
+}
+
+bool io_reactor::cancel(io_op& op) {
+    fd_state& st = states_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+    for (size_t d = 0; d < 2; ++d) {
+        io_op* prev = nullptr;
+        for (io_op* it = st.head[d]; it; prev = it, it = it->next) {
+            if (it != &op) {
+                continue;
+            }
+            (prev ? prev->next : st.head[d]) = op.next;
+            if (st.tail[d] == &op) {
+                st.tail[d] = prev;
+            }
+            op.next = nullptr;
+            op.result = -ECANCELED;
+            return true;
+        }
+    }
+    return false;
+}
+
+void io_reactor::close(int fd) {
+    io_op* cancelled = nullptr;
+    {
+        fd_state& st = states_[fd];
+        std::lock_guard<std::mutex> lock(st.mutex);
+        if (st.registered) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            st.registered = false;
+        }
+
+        for (size_t d = 0; d < 2; ++d) {
+            while (io_op* op = st.head[d]) {
+                st.head[d] = op->next;
+                op->result = -ECANCELED;
+                op->next = cancelled;
+                cancelled = op;
+            }
+            st.tail[d] = nullptr;
+        }
+    }
+    ::close(fd);
+
+    while (cancelled) {
+        io_op* next = cancelled->next;
+        cancelled->exec_->schedule(cancelled->handle_);
+        cancelled = next;
+    }
+}
+
+void io_reactor::run() {
+    constexpr int max_events = 256;
+    epoll_event events[max_events];
+
+    while (!stopped_.load(std::memory_order_acquire)) {
+        int n = epoll_wait(epoll_fd_, events, max_events, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::fprintf(stderr, "[io_reactor] epoll_wait failed: errno %d\n", errno);
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            auto* st = static_cast<fd_state*>(events[i].data.ptr);
+            if (!st) {
+                continue;  // Wakeup from stop()
+            }
+
+            uint32_t ev = events[i].events;
+            io_op* done = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(st->mutex);
+                if (!st->registered) {
+                    continue;  // Stale event for a closed fd
+                }
+                if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    done = run_ready(*st, direction::read);
+                }
+                if (ev & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+                    io_op* written = run_ready(*st, direction::write);
+                    if (written) {
+                        io_op* tail = written;
+                        while (tail->next) {
+                            tail = tail->next;
+                        }
+                        tail->next = done;
+                        done = written;
+                    }
+                }
+            }
+
+            // Scheduling is the last access to each op: once resumed, the
+            // awaiting coroutine may destroy it
+            while (done) {
+                io_op* next = done->next;
+                done->exec_->schedule(done->handle_);
+                done = next;
+            }
+        }
+    }
+}
+
+bool recv_awaiter::try_once() {
+    while (true) {
+        ssize_t n = ::recv(fd, buffer_, size_, MSG_DONTWAIT);
+        if (n >= 0) {
+            result = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+        result = -errno;
+        return true;
+    }
+}
+
+bool send_awaiter::try_once() {
+    while (sent_ < size_) {
+        ssize_t n = ::send(fd, static_cast<const char*>(data_) + sent_, size_ - sent_,
+                           MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n >= 0) {
+            sent_ += static_cast<size_t>(n);
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+        result = -errno;
+        return true;
+    }
+    result = static_cast<ssize_t>(sent_);
+    return true;
+}
+
+bool accept_awaiter::try_once() {
+    while (true) {
+        int client = ::accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client >= 0) {
+            result = client;
+            return true;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+        result = -errno;
+        return true;
+    }
+}
+
+namespace {
+    // Fds beyond the per-fd tables fail instead of aliasing another fd's state
+    bool reject_untracked(io_op& op) {
+        if (io_reactor::tracks(op.fd)) {
+            return false;
+        }
+        op.result = op.fd < 0 ? -EBADF : -EMFILE;
+        return true;
+    }
+}
+
+bool recv_awaiter::start() {
+    if (reject_untracked(*this)) {
+        return false;
+    }
+    if (auto* ring = io_uring_engine::instance()) {
+        return ring->recv(*this);
+    }
+    perform = [](io_op& op) { return static_cast<recv_awaiter&>(op).try_once(); };
+    return get_io_reactor().submit(*this, io_reactor::direction::read);
+}
+
+bool send_awaiter::start() {
+    if (reject_untracked(*this)) {
+        return false;
+    }
+    if (auto* ring = io_uring_engine::instance()) {
+        return ring->send(*this);
+    }
+    perform = [](io_op& op) { return static_cast<send_awaiter&>(op).try_once(); };
+    return get_io_reactor().submit(*this, io_reactor::direction::write);
+}
+
+bool accept_awaiter::start() {
+    if (reject_untracked(*this)) {
+        return false;
+    }
+    if (auto* ring = io_uring_engine::instance()) {
+        return ring->accept(*this);
+    }
+    perform = [](io_op& op) { return static_cast<accept_awaiter&>(op).try_once(); };
+    return get_io_reactor().submit(*this, io_reactor::direction::read);
+}
+
+void cancel_io(io_op& op) {
+    op.cancelled.store(true, std::memory_order_release);
+    if (!io_reactor::tracks(op.fd)) {
+        return;  // Never queued
+    }
+    bool unlinked;
+    if (auto* ring = io_uring_engine::instance()) {
+        unlinked = ring->cancel(op);
+    } else {
+        unlinked = get_io_reactor().cancel(op);
+    }
+    if (unlinked) {
+        op.exec_->schedule(op.handle_);
+    }
+}
+
+void close_socket(int fd) {
+    if (!io_reactor::tracks(fd)) {
+        ::close(fd);
+    } else if (auto* ring = io_uring_engine::instance()) {
+        ring->close(fd);
+    } else {
+        get_io_reactor().close(fd);
+    }
+}
+
+const char* io_backend_name() {
+    return io_uring_engine::instance() ? "io_uring" : "epoll";
+}
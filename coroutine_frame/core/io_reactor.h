@@ -0,0 +1,208 @@
+#ifndef TASK_DO_IO_REACTOR_H
+#define TASK_DO_IO_REACTOR_H
+
+#include "executor.h"
+#include "cancellation_token.h"
+#include "fd_table.h"
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <sys/types.h>
+
+// A pending socket operation
+// Awaiters derive from this; perform() makes one non-blocking attempt and
+// returns false if the fd was not ready (EAGAIN), true once `result` is final.
+// Results follow the kernel convention: >= 0 on success, -errno on failure.
+struct io_op {
+    io_op() = default;
+    io_op(const io_op&) = delete;
+    io_op& operator=(const io_op&) = delete;
+
+    bool (*perform)(io_op&) = nullptr;
+    int fd = -1;
+    ssize_t result = 0;
+
+    std::coroutine_handle<> handle_;
+    executor* exec_ = nullptr;
+    io_op* next = nullptr;  // Owned by io_reactor
+
+    // Set by cancel_io() before it looks for the op, so a backend that
+    // receives the op afterwards fails it with -ECANCELED instead of queuing
+    std::atomic<bool> cancelled{false};
+};
+
+// Fail `op` with -ECANCELED if it is still queued and resume its coroutine;
+// an op already handed to the kernel completes on its own shortly after
+void cancel_io(io_op& op);
+
+// epoll-based reactor
+//
+// File descriptors are registered lazily (non-blocking, edge-triggered, both
+// directions) on their first operation. An operation is attempted as soon as
+// it is submitted and only queued (FIFO per direction) if it would block;
+// when epoll reports readiness the reactor thread retries queued operations
+// and schedules the coroutines whose operations completed on their executor.
+// Sockets used with the reactor must be closed through close().
+class io_reactor {
+public:
+    enum class direction { read = 0, write = 1 };
+
+    io_reactor();
+    ~io_reactor();
+
+    io_reactor(const io_reactor&) = delete;
+    io_reactor& operator=(const io_reactor&) = delete;
+
+    // Try op now unless others are queued ahead of it, otherwise queue it.
+    // Returns true if the op is pending (the caller stays suspended).
+    bool submit(io_op& op, direction dir);
+
+    // Deregister and close fd; queued operations complete with -ECANCELED
+    void close(int fd);
+
+    // Unlink op if it is still queued (result -ECANCELED); the caller then
+    // resumes it. False if it has already completed.
+    bool cancel(io_op& op);
+
+    // Stop the reactor thread
+    void stop();
+
+    // Whether fd is low enough to have per-fd state (both backends)
+    static bool tracks(int fd) noexcept { return fd_table<fd_state>::contains(fd); }
+
+private:
+    struct fd_state {
+        std::mutex mutex;
+        bool registered = false;
+        std::array<io_op*, 2> head{};
+        std::array<io_op*, 2> tail{};
+    };
+
+    void register_fd(int fd, fd_state& st);
+    io_op* run_ready(fd_state& st, direction dir);
+    void run();
+
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::atomic<bool> stopped_{false};
+
+    fd_table<fd_state> states_;
+
+    std::thread thread_;
+};
+
+// Global reactor instance
+inline io_reactor& get_io_reactor() {
+    static io_reactor reactor;
+    return reactor;
+}
+
+// Base awaitable: starts the op on the active backend (io_uring when the
+// kernel supports it, epoll otherwise) when the coroutine suspends, and
+// resumes the coroutine on the executor it ran on once the op has completed.
+// With a token, cancelling it resumes the coroutine at once with -ECANCELED.
+template<typename Derived>
+struct io_awaiter : io_op {
+    std::optional<cancellation_token> token_;
+    cancellation_registration registration_;
+
+    explicit io_awaiter(std::optional<cancellation_token> token) : token_(std::move(token)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        exec_ = &current_executor();
+        if (token_) {
+            // Hooked before start(): afterwards the op may complete and free us
+            registration_.attach(*token_, [](void* op) { cancel_io(*static_cast<io_op*>(op)); },
+                                 static_cast<io_op*>(this));
+        }
+        return static_cast<Derived&>(*this).start();
+    }
+
+    ssize_t await_resume() noexcept {
+        registration_.reset();
+        return result;
+    }
+};
+
+// co_await async_recv(fd, buf, len) -> bytes received, 0 on EOF, or -errno
+struct recv_awaiter : io_awaiter<recv_awaiter> {
+    recv_awaiter(int socket_fd, void* buffer, size_t size, std::optional<cancellation_token> token = {})
+        : io_awaiter(std::move(token)), buffer_(buffer), size_(size) {
+        fd = socket_fd;
+    }
+
+    bool start();
+    bool try_once();
+
+    void* buffer_;
+    size_t size_;
+};
+
+// co_await async_send(fd, buf, len) -> bytes sent (the whole buffer unless an
+// error occurs), or -errno. Concurrent sends on one fd never interleave.
+struct send_awaiter : io_awaiter<send_awaiter> {
+    send_awaiter(int socket_fd, const void* data, size_t size, std::optional<cancellation_token> token = {})
+        : io_awaiter(std::move(token)), data_(data), size_(size) {
+        fd = socket_fd;
+    }
+
+    bool start();
+    bool try_once();
+
+    const void* data_;
+    size_t size_;
+    size_t sent_ = 0;
+    uint32_t generation_ = 0;  // io_uring: stream generation it was queued in
+};
+
+// co_await async_accept(listen_fd) -> new non-blocking client fd, or -errno
+struct accept_awaiter : io_awaiter<accept_awaiter> {
+    explicit accept_awaiter(int listen_fd, std::optional<cancellation_token> token = {})
+        : io_awaiter(std::move(token)) {
+        fd = listen_fd;
+    }
+
+    bool start();
+    bool try_once();
+};
+
+inline recv_awaiter async_recv(int fd, void* buffer, size_t size) {
+    return recv_awaiter{fd, buffer, size};
+}
+
+inline send_awaiter async_send(int fd, const void* data, size_t size) {
+    return send_awaiter{fd, data, size};
+}
+
+inline accept_awaiter async_accept(int listen_fd) {
+    return accept_awaiter{listen_fd};
+}
+
+// Cancellable forms: -ECANCELED once `token` is cancelled. A cancelled send
+// may have written part of the buffer.
+inline recv_awaiter async_recv(int fd, void* buffer, size_t size, const cancellation_token& token) {
+    return recv_awaiter{fd, buffer, size, token};
+}
+
+inline send_awaiter async_send(int fd, const void* data, size_t size, const cancellation_token& token) {
+    return send_awaiter{fd, data, size, token};
+}
+
+inline accept_awaiter async_accept(int listen_fd, const cancellation_token& token) {
+    return accept_awaiter{listen_fd, token};
+}
+
+// Close a socket that has been used with async_recv/async_send/async_accept
+void close_socket(int fd);
+
+// Name of the backend serving the socket awaitables: "io_uring" or "epoll"
+const char* io_backend_name();
+
+#endif //TASK_DO_IO_REACTOR_H
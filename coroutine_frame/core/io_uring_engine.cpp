@@ -0,0 +1,793 @@
+#include "io_uring_engine.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    template<typename T>
+    T load_acquire(T* p) {
+        return std::atomic_ref<T>(*p).load(std::memory_order_acquire);
+    }
+
+    template<typename T>
+    void store_release(T* p, T value) {
+        std::atomic_ref<T>(*p).store(value, std::memory_order_release);
+    }
+
+    // user_data layout: low 3 bits are the tag. Per-op requests carry the
+    // (8-byte aligned) awaiter address; per-fd requests (accept, multishot
+    // recv) carry the fd in bits 3-31 and the fd_stream generation in bits
+    // 32-63.
+    enum : uint64_t {
+        tag_ignore = 0,
+        tag_send = 1,
+        tag_accept = 2,
+        tag_recv = 3,
+        tag_recv_direct = 4,
+        tag_mask = 7
+    };
+
+    uint64_t op_data(io_op& op, uint64_t tag) {
+        return reinterpret_cast<uint64_t>(&op) | tag;
+    }
+
+    uint64_t stream_data(int fd, uint32_t generation, uint64_t tag) {
+        return (uint64_t{generation} << 32) | (uint64_t{static_cast<uint32_t>(fd)} << 3) | tag;
+    }
+
+    constexpr unsigned ring_entries = 4096;
+
+    // Set on the completion thread, whose SQEs go out with its next wait
+    thread_local bool completion_thread = false;
+
+    void push_done(io_op*& done, io_op& op) {
+        op.next = done;
+        done = &op;
+    }
+
+    io_op* pop_front(io_op*& head, io_op*& tail) {
+        io_op* op = head;
+        head = op->next;
+        if (!head) {
+            tail = nullptr;
+        }
+        op->next = nullptr;
+        return op;
+    }
+
+    void push_back(io_op*& head, io_op*& tail, io_op& op) {
+        op.next = nullptr;
+        if (tail) {
+            tail->next = &op;
+        } else {
+            head = &op;
+        }
+        tail = &op;
+    }
+
+    bool unlink(io_op*& head, io_op*& tail, io_op& op) {
+        io_op* prev = nullptr;
+        for (io_op* it = head; it; prev = it, it = it->next) {
+            if (it == &op) {
+                (prev ? prev->next : head) = op.next;
+                if (tail == &op) {
+                    tail = prev;
+                }
+                op.next = nullptr;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Called with the stream mutex held by every entry point, so it cannot
+    // race with cancel() looking for the op
+    bool fail_if_cancelled(io_op& op) {
+        if (op.cancelled.load(std::memory_order_acquire)) {
+            op.result = -ECANCELED;
+            return true;
+        }
+        return false;
+    }
+}
+
+io_uring_engine* io_uring_engine::instance() {
+    static std::unique_ptr<io_uring_engine> engine = []() -> std::unique_ptr<io_uring_engine> {
+        const char* backend = std::getenv("TASK_DO_IO_BACKEND");
+        if (backend && std::string_view(backend) == "epoll") {
+            return nullptr;
+        }
+        std::unique_ptr<io_uring_engine> e(new io_uring_engine());
+        if (!e->init()) {
+            return nullptr;
+        }
+        return e;
+    }();
+    return engine.get();
+}
+
+io_uring_engine::~io_uring_engine() {
+    stop();
+    if (buffer_ring_) {
+        munmap(buffer_ring_, buffer_ring_size_);
+    }
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+    }
+}
+
+bool io_uring_engine::init() {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = ring_entries * 4;
+
+    ring_fd_ = sys_io_uring_setup(ring_entries, &params);
+    if (ring_fd_ < 0) {
+        return false;
+    }
+
+    // Every opcode we rely on must be supported
+    constexpr unsigned probe_ops = 256;
+    std::unique_ptr<char[]> probe_storage(
+        new char[sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op)]());
+    auto* probe = reinterpret_cast<io_uring_probe*>(probe_storage.get());
+    if (sys_io_uring_register(ring_fd_, IORING_REGISTER_PROBE, probe, probe_ops) < 0) {
+        return false;
+    }
+    for (unsigned op : {IORING_OP_NOP, IORING_OP_ACCEPT, IORING_OP_RECV,
+                        IORING_OP_SEND, IORING_OP_ASYNC_CANCEL}) {
+        if (op >= probe->ops_len || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    // Map the rings
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            return false;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_entries);
+    auto* sq_array = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    for (uint32_t i = 0; i < sq_entries_; ++i) {
+        sq_array[i] = i;  // SQE slot i always sits at array index i
+    }
+
+    auto* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Register the provided-buffer ring used by multishot recv
+    buffer_ring_size_ = buffer_count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        return false;
+    }
+    buffer_ring_ = static_cast<io_uring_buf_ring*>(ring);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buffer_ring_);
+    reg.ring_entries = buffer_count;
+    reg.bgid = buffer_group;
+    if (sys_io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return false;
+    }
+
+    buffers_.reset(new char[size_t{buffer_count} * buffer_size]);
+    for (uint32_t i = 0; i < buffer_count; ++i) {
+        return_buffer(static_cast<uint16_t>(i));
+    }
+
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void io_uring_engine::stop() {
+    if (!thread_.joinable() || stopped_.exchange(true)) {
+        return;
+    }
+    // A NOP completion wakes the completion thread so it sees stopped_
+    submit([](io_uring_sqe& sqe) {
+        sqe.opcode = IORING_OP_NOP;
+        sqe.user_data = tag_ignore;
+    });
+    flush_queued();
+    thread_.join();
+}
+
+// Called with sq_mutex_ held
+io_uring_sqe* io_uring_engine::acquire_sqe(std::unique_lock<std::mutex>& lock) {
+    while (true) {
+        uint32_t tail = *sq_tail_;
+        if (tail - load_acquire(sq_head_) < sq_entries_) {
+            io_uring_sqe* sqe = &sqes_[tail & sq_mask_];
+            std::memset(sqe, 0, sizeof(*sqe));
+            return sqe;
+        }
+        // Full: wait for the SQEs already queued to be handed to the kernel
+        if (!flushing_) {
+            flush(lock);
+        } else {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+}
+
+// The SQE is only queued here. The completion thread submits it with its
+// next wait for completions, a worker once its resume batch ends, and any
+// other thread right away.
+template<typename Prepare>
+void io_uring_engine::submit(Prepare&& prepare) {
+    std::unique_lock<std::mutex> lock(sq_mutex_);
+    io_uring_sqe* sqe = acquire_sqe(lock);
+    prepare(*sqe);
+    store_release(sq_tail_, *sq_tail_ + 1);
+    ++unsubmitted_;
+
+    if (completion_thread || executor::flush_after_batch(&flush_instance)) {
+        return;
+    }
+    flush(lock);
+}
+
+void io_uring_engine::flush_instance() {
+    if (auto* engine = instance()) {
+        engine->flush_queued();
+    }
+}
+
+void io_uring_engine::flush_queued() {
+    std::unique_lock<std::mutex> lock(sq_mutex_);
+    flush(lock);
+}
+
+// Called with sq_mutex_ held. Only one thread at a time flushes; SQEs queued
+// meanwhile are picked up by its next round, so bursts from many threads
+// collapse into a few syscalls. Each io_uring_enter claims the SQEs it
+// passes and hands back whatever the kernel did not take, so the completion
+// thread can submit alongside a flush.
+void io_uring_engine::flush(std::unique_lock<std::mutex>& lock) {
+    if (flushing_) {
+        return;
+    }
+    flushing_ = true;
+
+    while (unsubmitted_ > 0) {
+        uint32_t count = std::exchange(unsubmitted_, 0);
+        lock.unlock();
+        int submitted = sys_io_uring_enter(ring_fd_, count, 0, 0);
+        int err = errno;
+        if (submitted < 0) {
+            std::this_thread::yield();
+        }
+        lock.lock();
+
+        unsubmitted_ += count - static_cast<uint32_t>(std::max(submitted, 0));
+        if (submitted < 0 && err != EINTR && err != EAGAIN && err != EBUSY) {
+            std::fprintf(stderr, "[io_uring] io_uring_enter failed: errno %d\n", err);
+            break;
+        }
+    }
+
+    flushing_ = false;
+}
+
+void io_uring_engine::return_buffer(uint16_t buffer_id) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    io_uring_buf& buf = buffer_ring_->bufs[buffer_tail_ & (buffer_count - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(buffers_.get() + size_t{buffer_id} * buffer_size);
+    buf.len = buffer_size;
+    buf.bid = buffer_id;
+    ++buffer_tail_;
+    store_release(&buffer_ring_->tail, buffer_tail_);
+}
+
+void io_uring_engine::submit_cancel(uint64_t user_data) {
+    submit([user_data](io_uring_sqe& sqe) {
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr = user_data;
+        sqe.user_data = tag_ignore;
+    });
+}
+
+// ---------------------------------------------------------------------------
+// accept
+// ---------------------------------------------------------------------------
+
+bool io_uring_engine::accept(accept_awaiter& op) {
+    fd_stream& st = streams_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    if (fail_if_cancelled(op)) {
+        return false;
+    }
+    if (!st.accepted.empty()) {
+        op.result = st.accepted.front();
+        st.accepted.pop_front();
+        return false;
+    }
+
+    push_back(st.accept_head, st.accept_tail, op);
+    if (!st.accept_armed) {
+        arm_accept(op.fd, st);
+    }
+    return true;
+}
+
+// Called with st.mutex held
+void io_uring_engine::arm_accept(int fd, fd_stream& st) {
+    st.accept_armed = true;
+    uint64_t data = stream_data(fd, st.generation, tag_accept);
+    submit([fd, data](io_uring_sqe& sqe) {
+        sqe.opcode = IORING_OP_ACCEPT;
+        sqe.fd = fd;
+        sqe.accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe.user_data = data;
+    });
+}
+
+void io_uring_engine::on_accept(int fd, uint32_t gen, int32_t res, uint32_t flags, io_op*& done) {
+    fd_stream& st = streams_[fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    if (gen != st.generation) {
+        // Listener already closed
+        if (res >= 0) {
+            ::close(res);
+        }
+        return;
+    }
+    st.accept_armed = false;
+
+    if (st.accept_head) {
+        io_op* op = pop_front(st.accept_head, st.accept_tail);
+        op->result = res;
+        push_done(done, *op);
+    } else if (res >= 0) {
+        if (st.accepted.size() < accept_queue_limit) {
+            st.accepted.push_back(res);
+        } else {
+            ::close(res);
+        }
+    }
+
+    if (st.accept_head) {
+        arm_accept(fd, st);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// recv
+// ---------------------------------------------------------------------------
+
+bool io_uring_engine::recv(recv_awaiter& op) {
+    fd_stream& st = streams_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    if (fail_if_cancelled(op)) {
+        return false;
+    }
+    if (!st.recv_head && drain_chunks(st, op)) {
+        return false;
+    }
+
+    push_back(st.recv_head, st.recv_tail, op);
+    if (!st.recv_armed && !st.recv_direct) {
+        arm_recv(op.fd, st);
+    }
+    return true;
+}
+
+// Called with st.mutex held. Copies buffered data (or the final EOF/error
+// status) into op; returns false if there is nothing to deliver yet.
+bool io_uring_engine::drain_chunks(fd_stream& st, recv_awaiter& op) {
+    if (st.chunks.empty()) {
+        if (st.recv_finished) {
+            op.result = st.recv_status;
+            return true;
+        }
+        return false;
+    }
+
+    auto* out = static_cast<char*>(op.buffer_);
+    size_t copied = 0;
+    while (copied < op.size_ && !st.chunks.empty()) {
+        recv_chunk& chunk = st.chunks.front();
+        size_t n = std::min<size_t>(op.size_ - copied, chunk.length - chunk.offset);
+        std::memcpy(out + copied,
+                    buffers_.get() + size_t{chunk.buffer_id} * buffer_size + chunk.offset, n);
+        copied += n;
+        chunk.offset += static_cast<uint32_t>(n);
+        if (chunk.offset == chunk.length) {
+            return_buffer(chunk.buffer_id);
+            st.chunks.pop_front();
+        }
+    }
+    op.result = static_cast<ssize_t>(copied);
+    return true;
+}
+
+// Called with st.mutex held
+void io_uring_engine::arm_recv(int fd, fd_stream& st) {
+    st.recv_armed = true;
+    uint64_t data = stream_data(fd, st.generation, tag_recv);
+    uint16_t prio = multishot_recv_.load(std::memory_order_relaxed) ? IORING_RECV_MULTISHOT : 0;
+    submit([fd, data, prio](io_uring_sqe& sqe) {
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = fd;
+        sqe.ioprio = prio;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = buffer_group;
+        sqe.user_data = data;
+    });
+}
+
+void io_uring_engine::on_recv(int fd, uint32_t gen, int32_t res, uint32_t flags, io_op*& done) {
+    fd_stream& st = streams_[fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    bool has_buffer = flags & IORING_CQE_F_BUFFER;
+    auto buffer_id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+
+    if (gen != st.generation) {
+        if (has_buffer) {
+            return_buffer(buffer_id);
+        }
+        return;
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+        st.recv_armed = false;
+    }
+
+    if (res > 0 && has_buffer) {
+        st.chunks.push_back({buffer_id, static_cast<uint32_t>(res), 0});
+    } else {
+        if (has_buffer) {
+            return_buffer(buffer_id);
+        }
+        if (res == -EINVAL && multishot_recv_.exchange(false)) {
+            // Kernel has provided buffers but not multishot recv (5.19):
+            // keep going with one-shot buffer-select recvs
+        } else if (res != -ENOBUFS) {
+            st.recv_finished = true;
+            st.recv_status = res;
+        }
+    }
+
+    while (st.recv_head && (!st.chunks.empty() || st.recv_finished)) {
+        auto& op = static_cast<recv_awaiter&>(*pop_front(st.recv_head, st.recv_tail));
+        drain_chunks(st, op);
+        push_done(done, op);
+    }
+
+    if (!st.recv_head || st.recv_armed || st.recv_direct || st.recv_finished) {
+        return;
+    }
+    if (res == -ENOBUFS) {
+        // Every pooled buffer is holding unread data for some connection:
+        // read straight into this waiter's own buffer instead
+        auto& op = static_cast<recv_awaiter&>(*pop_front(st.recv_head, st.recv_tail));
+        st.recv_direct = &op;
+        uint64_t data = op_data(op, tag_recv_direct);
+        submit([&op, data](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_RECV;
+            sqe.fd = op.fd;
+            sqe.addr = reinterpret_cast<uint64_t>(op.buffer_);
+            sqe.len = static_cast<uint32_t>(op.size_);
+            sqe.user_data = data;
+        });
+    } else {
+        arm_recv(fd, st);
+    }
+}
+
+void io_uring_engine::on_recv_direct(recv_awaiter& op, int32_t res, io_op*& done) {
+    fd_stream& st = streams_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    op.result = res;
+    if (st.recv_direct == &op) {
+        st.recv_direct = nullptr;
+        // A cancelled direct recv says nothing about the stream itself
+        bool cancelled = res == -ECANCELED && op.cancelled.load(std::memory_order_relaxed);
+        if (res <= 0 && !cancelled) {
+            st.recv_finished = true;
+            st.recv_status = res;
+        }
+        while (st.recv_finished && st.recv_head) {
+            auto& waiter = static_cast<recv_awaiter&>(*pop_front(st.recv_head, st.recv_tail));
+            drain_chunks(st, waiter);
+            push_done(done, waiter);
+        }
+        if (st.recv_head && !st.recv_armed) {
+            arm_recv(op.fd, st);
+        }
+    }
+    push_done(done, op);
+}
+
+// ---------------------------------------------------------------------------
+// send
+// ---------------------------------------------------------------------------
+
+bool io_uring_engine::send(send_awaiter& op) {
+    fd_stream& st = streams_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    if (fail_if_cancelled(op)) {
+        return false;
+    }
+    op.generation_ = st.generation;
+    push_back(st.send_head, st.send_tail, op);
+    if (st.send_head == &op) {
+        submit_send(op);
+    }
+    return true;
+}
+
+void io_uring_engine::submit_send(send_awaiter& op) {
+    uint64_t data = op_data(op, tag_send);
+    submit([&op, data](io_uring_sqe& sqe) {
+        sqe.opcode = IORING_OP_SEND;
+        sqe.fd = op.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(static_cast<const char*>(op.data_) + op.sent_);
+        sqe.len = static_cast<uint32_t>(op.size_ - op.sent_);
+        sqe.msg_flags = MSG_NOSIGNAL;
+        sqe.user_data = data;
+    });
+}
+
+void io_uring_engine::on_send(send_awaiter& op, int32_t res, io_op*& done) {
+    fd_stream& st = streams_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    // Once close() has run the fd number may already name another socket:
+    // nothing more goes out on it, neither the rest of op nor a queued send
+    bool current = st.send_head == &op && st.generation == op.generation_;
+    if (res > 0) {
+        op.sent_ += static_cast<size_t>(res);
+        if (op.sent_ < op.size_) {
+            if (current && !op.cancelled.load(std::memory_order_acquire)) {
+                submit_send(op);  // Short send: keep our place at the head
+                return;
+            }
+            res = -ECANCELED;
+        }
+    }
+    op.result = res < 0 ? res : static_cast<ssize_t>(op.sent_);
+
+    if (current) {
+        pop_front(st.send_head, st.send_tail);
+        if (st.send_head) {
+            submit_send(static_cast<send_awaiter&>(*st.send_head));
+        }
+    }
+    push_done(done, op);
+}
+
+// ---------------------------------------------------------------------------
+// close
+// ---------------------------------------------------------------------------
+
+void io_uring_engine::close(int fd) {
+    io_op* cancelled = nullptr;
+    {
+        fd_stream& st = streams_[fd];
+        std::lock_guard<std::mutex> lock(st.mutex);
+
+        // Completions still in flight for the old generation are ignored
+        uint32_t old_generation = st.generation++;
+        if (st.accept_armed) {
+            submit_cancel(stream_data(fd, old_generation, tag_accept));
+            st.accept_armed = false;
+        }
+        if (st.recv_armed) {
+            submit_cancel(stream_data(fd, old_generation, tag_recv));
+            st.recv_armed = false;
+        }
+        if (st.recv_direct) {
+            // Its completion still resumes the waiter
+            submit_cancel(op_data(*st.recv_direct, tag_recv_direct));
+            st.recv_direct = nullptr;
+        }
+
+        for (int client : st.accepted) {
+            ::close(client);
+        }
+        st.accepted.clear();
+        for (const recv_chunk& chunk : st.chunks) {
+            return_buffer(chunk.buffer_id);
+        }
+        st.chunks.clear();
+        st.recv_finished = false;
+        st.recv_status = 0;
+
+        // The send in flight (if any) is cancelled and its completion resumes
+        // it without sending more; the rest never start
+        if (st.send_head) {
+            submit_cancel(op_data(*st.send_head, tag_send));
+            io_op* queued = st.send_head->next;
+            st.send_head = st.send_tail = nullptr;
+            while (queued) {
+                io_op* next = queued->next;
+                queued->result = -ECANCELED;
+                push_done(cancelled, *queued);
+                queued = next;
+            }
+        }
+        for (io_op** head : {&st.accept_head, &st.recv_head}) {
+            while (*head) {
+                io_op* op = *head;
+                *head = op->next;
+                op->result = -ECANCELED;
+                push_done(cancelled, *op);
+            }
+        }
+        st.accept_tail = st.recv_tail = nullptr;
+    }
+    ::close(fd);
+
+    while (cancelled) {
+        io_op* next = cancelled->next;
+        cancelled->exec_->schedule(cancelled->handle_);
+        cancelled = next;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// cancel
+// ---------------------------------------------------------------------------
+
+bool io_uring_engine::cancel(io_op& op) {
+    fd_stream& st = streams_[op.fd];
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    if (st.send_head == &op) {
+        // In flight: its completion (usually -ECANCELED) resumes it
+        submit_cancel(op_data(op, tag_send));
+        return false;
+    }
+    if (st.recv_direct == &op) {
+        submit_cancel(op_data(op, tag_recv_direct));
+        return false;
+    }
+    if (unlink(st.accept_head, st.accept_tail, op) || unlink(st.recv_head, st.recv_tail, op) ||
+        unlink(st.send_head, st.send_tail, op)) {
+        op.result = -ECANCELED;
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// completion thread
+// ---------------------------------------------------------------------------
+
+void io_uring_engine::handle(const io_uring_cqe& cqe, io_op*& done) {
+    uint64_t data = cqe.user_data;
+    switch (data & tag_mask) {
+        case tag_send:
+            on_send(*reinterpret_cast<send_awaiter*>(data & ~tag_mask), cqe.res, done);
+            break;
+        case tag_recv_direct:
+            on_recv_direct(*reinterpret_cast<recv_awaiter*>(data & ~tag_mask), cqe.res, done);
+            break;
+        case tag_accept:
+        case tag_recv: {
+            int fd = static_cast<int>((data >> 3) & 0x1FFFFFFF);
+            auto gen = static_cast<uint32_t>(data >> 32);
+            if ((data & tag_mask) == tag_accept) {
+                on_accept(fd, gen, cqe.res, cqe.flags, done);
+            } else {
+                on_recv(fd, gen, cqe.res, cqe.flags, done);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void io_uring_engine::run() {
+    completion_thread = true;
+    while (!stopped_.load(std::memory_order_acquire)) {
+        // Submit what the previous round queued in the same syscall
+        uint32_t count;
+        {
+            std::lock_guard<std::mutex> lock(sq_mutex_);
+            count = std::exchange(unsubmitted_, 0);
+        }
+        int r = sys_io_uring_enter(ring_fd_, count, 1, IORING_ENTER_GETEVENTS);
+        int err = errno;
+        if (static_cast<uint32_t>(std::max(r, 0)) < count) {
+            std::lock_guard<std::mutex> lock(sq_mutex_);
+            unsubmitted_ += count - static_cast<uint32_t>(std::max(r, 0));
+        }
+        if (r < 0 && err != EINTR && err != EAGAIN && err != EBUSY) {
+            std::fprintf(stderr, "[io_uring] wait for completions failed: errno %d\n", err);
+            return;
+        }
+
+        io_op* done = nullptr;
+        uint32_t head = *cq_head_;
+        uint32_t tail = load_acquire(cq_tail_);
+        while (head != tail) {
+            handle(cqes_[head & cq_mask_], done);
+            ++head;
+        }
+        store_release(cq_head_, head);
+
+        // Scheduling is the last access to each op
+        while (done) {
+            io_op* next = done->next;
+            done->exec_->schedule(done->handle_);
+            done = next;
+        }
+    }
+}
@@ -0,0 +1,160 @@
+#ifndef TASK_DO_IO_URING_ENGINE_H
+#define TASK_DO_IO_URING_ENGINE_H
+
+#include "io_reactor.h"
+#include "fd_table.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+// io_uring completion engine behind the socket awaitables
+//
+// - Submission is batched: SQEs queued by the completion thread go out with
+//   its next wait for completions, and a worker flushes once at the end of
+//   its resume batch (executor::flush_after_batch) rather than per op. A
+//   flush calls io_uring_enter for every SQE queued so far, including ones
+//   added by other threads while it was in the kernel.
+// - Listening sockets get one one-shot accept at a time, and only while
+//   someone waits in async_accept; like the epoll path, clients nobody is
+//   ready for stay in the kernel backlog (and hit its limit). A multishot
+//   accept would drain the whole backlog into an unbounded queue.
+// - Connected sockets get one multishot recv that fills buffers from a ring
+//   registered with the kernel (IORING_REGISTER_PBUF_RING). async_recv copies
+//   out of those buffers and hands them back to the kernel once drained.
+// - Sends are queued per fd and issued one at a time, so concurrent sends on
+//   one socket never interleave.
+//
+// Requires Linux 5.19+. instance() returns nullptr when io_uring cannot be
+// set up (old kernel, seccomp, TASK_DO_IO_BACKEND=epoll) and the awaitables
+// use the epoll reactor instead.
+class io_uring_engine {
+public:
+    static io_uring_engine* instance();
+
+    ~io_uring_engine();
+
+    io_uring_engine(const io_uring_engine&) = delete;
+    io_uring_engine& operator=(const io_uring_engine&) = delete;
+
+    // Each returns true if the op is pending (the caller stays suspended)
+    bool recv(recv_awaiter& op);
+    bool send(send_awaiter& op);
+    bool accept(accept_awaiter& op);
+
+    // Cancel multishot requests for fd, fail pending ops and close it
+    void close(int fd);
+
+    // Unlink op if it is still queued (result -ECANCELED) and return true;
+    // an op already submitted to the kernel gets an async cancel instead
+    bool cancel(io_op& op);
+
+    void stop();
+
+private:
+    // Buffers shared by every multishot recv
+    static constexpr uint16_t buffer_group = 0;
+    static constexpr uint32_t buffer_count = 1024;   // Power of two
+    static constexpr uint32_t buffer_size = 4096;
+
+    // Connections whose waiter was cancelled while their accept was in
+    // flight, kept for the next async_accept; beyond this they are closed
+    static constexpr size_t accept_queue_limit = 64;
+
+    // A received chunk still holding data for async_recv
+    struct recv_chunk {
+        uint16_t buffer_id;
+        uint32_t length;
+        uint32_t offset;
+    };
+
+    struct fd_stream {
+        std::mutex mutex;
+        uint32_t generation = 0;  // Bumped on close so stale CQEs are ignored
+
+        bool accept_armed = false;
+        std::deque<int> accepted;
+        io_op* accept_head = nullptr;
+        io_op* accept_tail = nullptr;
+
+        bool recv_armed = false;
+        recv_awaiter* recv_direct = nullptr;  // One-shot recv issued on ENOBUFS
+        bool recv_finished = false;           // EOF or error reached
+        ssize_t recv_status = 0;
+        std::deque<recv_chunk> chunks;
+        io_op* recv_head = nullptr;
+        io_op* recv_tail = nullptr;
+
+        io_op* send_head = nullptr;  // Head is the send in flight
+        io_op* send_tail = nullptr;
+    };
+
+    io_uring_engine() = default;
+    bool init();
+
+    io_uring_sqe* acquire_sqe(std::unique_lock<std::mutex>& lock);
+    template<typename Prepare>
+    void submit(Prepare&& prepare);
+    void flush(std::unique_lock<std::mutex>& lock);
+    void flush_queued();
+    static void flush_instance();
+
+    void arm_accept(int fd, fd_stream& st);
+    void arm_recv(int fd, fd_stream& st);
+    void submit_send(send_awaiter& op);
+    void submit_cancel(uint64_t user_data);
+
+    bool drain_chunks(fd_stream& st, recv_awaiter& op);
+    void return_buffer(uint16_t buffer_id);
+
+    void run();
+    void handle(const io_uring_cqe& cqe, io_op*& done);
+    void on_accept(int fd, uint32_t gen, int32_t res, uint32_t flags, io_op*& done);
+    void on_recv(int fd, uint32_t gen, int32_t res, uint32_t flags, io_op*& done);
+    void on_recv_direct(recv_awaiter& op, int32_t res, io_op*& done);
+    void on_send(send_awaiter& op, int32_t res, io_op*& done);
+
+    int ring_fd_ = -1;
+
+    // Submission queue (mmapped), guarded by sq_mutex_
+    std::mutex sq_mutex_;
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    uint32_t* sq_head_ = nullptr;
+    uint32_t* sq_tail_ = nullptr;
+    uint32_t sq_mask_ = 0;
+    uint32_t sq_entries_ = 0;
+    uint32_t unsubmitted_ = 0;
+    bool flushing_ = false;
+
+    // Completion queue (mmapped), consumed only by the completion thread
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    uint32_t* cq_head_ = nullptr;
+    uint32_t* cq_tail_ = nullptr;
+    uint32_t cq_mask_ = 0;
+
+    // Provided buffer ring, guarded by buffer_mutex_
+    std::mutex buffer_mutex_;
+    io_uring_buf_ring* buffer_ring_ = nullptr;
+    size_t buffer_ring_size_ = 0;
+    std::unique_ptr<char[]> buffers_;
+    uint16_t buffer_tail_ = 0;
+
+    std::atomic<bool> multishot_recv_{true};
+    std::atomic<bool> stopped_{false};
+    fd_table<fd_stream> streams_;
+    std::thread thread_;
+};
+
+#endif //TASK_DO_IO_URING_ENGINE_H
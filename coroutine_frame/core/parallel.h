@@ -0,0 +1,195 @@
+#ifndef TASK_DO_PARALLEL_H
+#define TASK_DO_PARALLEL_H
+
+#include "task.h"
+#include "executor.h"
+#include "when_all.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+// CPU-bound data parallelism on the coroutine executor
+//
+//     co_await parallel_for(0, n, 0, [&](size_t i) { out[i] = f(in[i]); });
+//     co_await parallel_for(items, 0, [](item& it) { it.update(); });
+//     long sum = co_await parallel_reduce(values, 0, 0L, std::plus<>{});
+//     co_await parallel_sort(v.begin(), v.end());
+//
+// Ranges are halved recursively: each split hands one half to the executor
+// and keeps working on the other (via when_all), so idle workers steal big
+// pieces first and the splitting itself is spread over the pool.
+//
+// parallel_for and parallel_reduce split lazily: they work through their
+// range one grain at a time and only halve what is left while the worker's
+// own deque is empty, i.e. while there is nothing queued for an idle worker
+// to steal. On a busy pool a range runs as a plain loop with no task per
+// leaf; an idle worker that steals the queued half makes the deque empty
+// again, and the next grain boundary splits once more. The grain is thus a
+// check interval rather than a leaf size. A grain of 0 picks one so that
+// every worker gets about eight of them; pass an explicit grain (elements
+// per check) when the cost per element is known. parallel_sort always
+// halves down to its grain, since its merges need the whole split tree.
+//
+// Everything runs on current_executor(), next to the I/O. The first
+// exception thrown by fn is rethrown once every leaf has finished.
+
+namespace detail {
+    inline size_t parallel_grain(size_t n, size_t grain) {
+        if (grain > 0) {
+            return grain;
+        }
+        constexpr size_t leaves_per_worker = 8;
+        size_t leaves = current_executor().thread_count() * leaves_per_worker;
+        return std::max<size_t>(1, (n + leaves - 1) / leaves);
+    }
+
+    // Split only when an idle worker could take the other half right away
+    inline bool parallel_should_split() noexcept {
+        return executor::local_queue_depth() == 0;
+    }
+
+    template<typename Fn>
+    task<void> parallel_for_split(size_t begin, size_t end, size_t grain, Fn& fn) {
+        while (end - begin > grain) {
+            if (parallel_should_split()) {
+                size_t mid = begin + (end - begin) / 2;
+                co_await when_all(parallel_for_split(begin, mid, grain, fn), parallel_for_split(mid, end, grain, fn));
+                co_return;
+            }
+            for (size_t stop = begin + grain; begin < stop; ++begin) {
+                fn(begin);
+            }
+        }
+        for (; begin < end; ++begin) {
+            fn(begin);
+        }
+    }
+
+    // Non-empty range only, so no identity element is needed. What was
+    // reduced before a split precedes both halves, so op keeps its order.
+    template<typename It, typename T, typename Op>
+    task<T> parallel_reduce_split(It first, size_t n, size_t grain, Op& op) {
+        T acc = *first;
+        size_t i = 1;
+        while (n - i > grain) {
+            if (parallel_should_split()) {
+                size_t half = (n - i) / 2;
+                auto [left, right] = co_await when_all(
+                    parallel_reduce_split<It, T>(first + i, half, grain, op),
+                    parallel_reduce_split<It, T>(first + i + half, n - i - half, grain, op));
+                co_return op(op(std::move(acc), std::move(left)), std::move(right));
+            }
+            for (size_t stop = i + grain; i < stop; ++i) {
+                acc = op(std::move(acc), first[i]);
+            }
+        }
+        for (; i < n; ++i) {
+            acc = op(std::move(acc), first[i]);
+        }
+        co_return acc;
+    }
+
+    // Merge sorted [a, a_end) and [b, b_end) into out, splitting the larger
+    // run at its middle and the other at the matching position
+    template<typename It, typename Out, typename Compare>
+    task<void> parallel_merge(It a, It a_end, It b, It b_end, Out out, size_t grain, Compare& comp) {
+        auto na = static_cast<size_t>(a_end - a);
+        auto nb = static_cast<size_t>(b_end - b);
+        if (na + nb <= grain) {
+            std::merge(std::make_move_iterator(a), std::make_move_iterator(a_end),
+                       std::make_move_iterator(b), std::make_move_iterator(b_end), out, comp);
+            co_return;
+        }
+        It a_mid, b_mid;
+        if (na >= nb) {
+            a_mid = a + na / 2;
+            b_mid = std::lower_bound(b, b_end, *a_mid, comp);
+        } else {
+            b_mid = b + nb / 2;
+            a_mid = std::upper_bound(a, a_end, *b_mid, comp);
+        }
+        Out out_mid = out + ((a_mid - a) + (b_mid - b));
+        co_await when_all(parallel_merge(a, a_mid, b, b_mid, out, grain, comp),
+                          parallel_merge(a_mid, a_end, b_mid, b_end, out_mid, grain, comp));
+    }
+
+    // Sort [first, first + n), leaving the result there or, with into_buf,
+    // in buf[0, n). Each level merges its halves from one array into the
+    // other, so no pass is spent copying back.
+    template<typename It, typename Buf, typename Compare>
+    task<void> parallel_sort_split(It first, Buf buf, size_t n, size_t grain, Compare& comp, bool into_buf) {
+        if (n <= grain) {
+            std::sort(first, first + n, comp);
+            if (into_buf) {
+                std::move(first, first + n, buf);
+            }
+            co_return;
+        }
+        size_t half = n / 2;
+        co_await when_all(parallel_sort_split(first, buf, half, grain, comp, !into_buf),
+                          parallel_sort_split(first + half, buf + half, n - half, grain, comp, !into_buf));
+
+        if (into_buf) {
+            co_await parallel_merge(first, first + half, first + half, first + n, buf, grain, comp);
+        } else {
+            co_await parallel_merge(buf, buf + half, buf + half, buf + n, first, grain, comp);
+        }
+    }
+}
+
+// fn(i) for every i in [begin, end)
+template<typename Fn>
+task<void> parallel_for(size_t begin, size_t end, size_t grain, Fn fn) {
+    co_await schedule_on(current_executor());
+    if (begin >= end) {
+        co_return;
+    }
+    co_await detail::parallel_for_split(begin, end, detail::parallel_grain(end - begin, grain), fn);
+}
+
+// fn(element) for every element of a random-access range; the range must
+// outlive the awaited task
+template<std::ranges::random_access_range Range, typename Fn>
+task<void> parallel_for(Range& range, size_t grain, Fn fn) {
+    auto first = std::ranges::begin(range);
+    auto body = [first, &fn](size_t i) { fn(first[i]); };
+    co_await parallel_for(0, static_cast<size_t>(std::ranges::size(range)), grain, body);
+}
+
+// init combined with every element through op, in no particular grouping:
+// op must be associative (but need not be commutative)
+template<std::ranges::random_access_range Range, typename T, typename Op>
+task<T> parallel_reduce(const Range& range, size_t grain, T init, Op op) {
+    co_await schedule_on(current_executor());
+    auto n = static_cast<size_t>(std::ranges::size(range));
+    if (n == 0) {
+        co_return init;
+    }
+    T total = co_await detail::parallel_reduce_split<decltype(std::ranges::begin(range)), T>(
+        std::ranges::begin(range), n, detail::parallel_grain(n, grain), op);
+    co_return op(std::move(init), std::move(total));
+}
+
+// Merge sort: halves are sorted in parallel, then merged in parallel through
+// a buffer of n elements (one allocation), so elements must be
+// default-constructible and movable. Not stable.
+template<std::random_access_iterator It, typename Compare = std::less<>>
+task<void> parallel_sort(It first, It last, Compare comp = {}, size_t grain = 0) {
+    co_await schedule_on(current_executor());
+    auto n = static_cast<size_t>(last - first);
+    if (n < 2) {
+        co_return;
+    }
+    // Sorting leaves need more work than a loop body to pay for a task; a
+    // merge needs at least two elements per leaf to always split
+    constexpr size_t min_sort_grain = 4096;
+    size_t g = grain > 0 ? std::max<size_t>(grain, 2) : std::max(min_sort_grain, detail::parallel_grain(n, 0));
+    std::vector<std::iter_value_t<It>> buf(n);
+    co_await detail::parallel_sort_split(first, buf.begin(), n, g, comp, false);
+}
+
+#endif //TASK_DO_PARALLEL_H
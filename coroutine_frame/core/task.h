@@ -9,6 +9,7 @@
 #include <exception>
 #include <utility>
 #include <type_traits>
+#include "frame_allocator.h"
 
 // Generic coroutine task class supporting any return type T
 // Specialization for void is provided below
@@ -47,6 +48,15 @@ public:
         std::suspend_always initial_suspend() noexcept { return {}; }
         final_awaiter final_suspend() noexcept { return {}; }
 
+        // Frames come from per-thread pools instead of the global heap
+        static void* operator new(std::size_t size) {
+            return frame_allocator::allocate(size);
+        }
+
+        static void operator delete(void* ptr, std::size_t size) noexcept {
+            frame_allocator::deallocate(ptr, size);
+        }
+
         void unhandled_exception() noexcept {
             result_ = std::current_exception();
         }
@@ -137,6 +147,17 @@ public:
         }
     }
 
+    // Like detach(), but hands back the not yet started coroutine instead of
+    // running it, e.g. for executor::submit() or executor::try_schedule().
+    // Whoever holds the handle must resume it, or destroy() it if unused.
+    std::coroutine_handle<> release_detached() noexcept {
+        if (!coro_) {
+            return nullptr;
+        }
+        coro_.promise().detached_ = true;
+        return std::exchange(coro_, nullptr);
+    }
+
 private:
     explicit task(std::coroutine_handle<promise_type> h) noexcept 
         : coro_(h) {}
@@ -180,6 +201,15 @@ public:
         std::suspend_always initial_suspend() noexcept { return {}; }
         final_awaiter final_suspend() noexcept { return {}; }
 
+        // Frames come from per-thread pools instead of the global heap
+        static void* operator new(std::size_t size) {
+            return frame_allocator::allocate(size);
+        }
+
+        static void operator delete(void* ptr, std::size_t size) noexcept {
+            frame_allocator::deallocate(ptr, size);
+        }
+
         void unhandled_exception() noexcept {
             exception_ = std::current_exception();
         }
@@ -264,6 +294,17 @@ public:
         }
     }
 
+    // Like detach(), but hands back the not yet started coroutine instead of
+    // running it, e.g. for executor::submit() or executor::try_schedule().
+    // Whoever holds the handle must resume it, or destroy() it if unused.
+    std::coroutine_handle<> release_detached() noexcept {
+        if (!coro_) {
+            return nullptr;
+        }
+        coro_.promise().detached_ = true;
+        return std::exchange(coro_, nullptr);
+    }
+
 private:
     explicit task(std::coroutine_handle<promise_type> h) noexcept 
         : coro_(h) {}
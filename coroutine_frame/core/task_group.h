@@ -0,0 +1,217 @@
+#ifndef TASK_DO_TASK_GROUP_H
+#define TASK_DO_TASK_GROUP_H
+
+#include "task.h"
+#include "executor.h"
+#include "when_all.h"
+#include "async_sync.h"
+#include "cancellation_token.h"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+class task_group;
+
+namespace detail {
+    // Runs one spawned task, then frees its frame and arrives at the group,
+    // resuming the joiner if it was the last one (like when_all_child)
+    struct task_group_child {
+        struct promise_type {
+            task_group* group_ = nullptr;
+
+            struct final_awaiter {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+                void await_resume() noexcept {}
+            };
+
+            task_group_child get_return_object() noexcept {
+                return task_group_child{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            final_awaiter final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }  // Bodies catch everything
+
+            static void* operator new(std::size_t size) {
+                return frame_allocator::allocate(size);
+            }
+
+            static void operator delete(void* ptr, std::size_t size) noexcept {
+                frame_allocator::deallocate(ptr, size);
+            }
+        };
+
+        explicit task_group_child(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+        task_group_child(task_group_child&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+        task_group_child& operator=(task_group_child&&) = delete;
+
+        ~task_group_child() {
+            if (handle_) {
+                handle_.destroy();
+            }
+        }
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    template<typename T>
+    task_group_child task_group_run(task<T> t, task_group& group);
+}
+
+// Structured fan-out with a cap on how many tasks run at once
+//
+//     task_group group(64);                        // At most 64 in flight
+//     for (auto& id : ids) {
+//         co_await group.spawn(fetch(id, group.token()));
+//     }
+//     co_await group.join();                       // Rethrows the first error
+//
+// spawn() suspends the spawning coroutine while the group is at its limit,
+// so a loop over 100k items keeps at most max_in_flight + 1 task frames
+// alive. Results are discarded; tasks report through captured state.
+//
+// The first task to fail cancels token(), so siblings that observe it can
+// stop early, and later spawn() calls drop their task and return false.
+// join() waits for every spawned task and then rethrows that first error.
+// A group must be joined before it is destroyed, and nothing may spawn
+// into it once join() has been called. After join() returns it can be
+// reused, but a cancelled group stays cancelled.
+class task_group {
+public:
+    static constexpr size_t unlimited = 0;
+
+    explicit task_group(size_t max_in_flight = unlimited, cancellation_token token = {})
+        : limited_(max_in_flight != unlimited), slots_(max_in_flight), token_(std::move(token)) {}
+
+    task_group(const task_group&) = delete;
+    task_group& operator=(const task_group&) = delete;
+
+    // co_await spawn(t): waits for a free slot, then starts t on the
+    // current executor; false if the group was cancelled and t was dropped
+    class [[nodiscard]] spawn_awaiter {
+    public:
+        spawn_awaiter(task_group& group, detail::task_group_child child) noexcept
+            : group_(group), child_(std::move(child)), acquire_(group.slots_) {}
+
+        bool await_ready() noexcept { return !group_.limited_ || acquire_.await_ready(); }
+        bool await_suspend(std::coroutine_handle<> handle) { return acquire_.await_suspend(handle); }
+
+        bool await_resume() {
+            if (group_.token_.is_cancelled()) {
+                group_.release_slot();
+                return false;  // child_ frees the unstarted task
+            }
+            group_.pending_.fetch_add(1, std::memory_order_relaxed);
+            group_.active_.fetch_add(1, std::memory_order_relaxed);
+            auto h = std::exchange(child_.handle_, nullptr);
+            h.promise().group_ = &group_;
+            current_executor().schedule(h);
+            return true;
+        }
+
+    private:
+        task_group& group_;
+        detail::task_group_child child_;
+        async_semaphore::acquire_awaiter acquire_;
+    };
+
+    template<typename T>
+    spawn_awaiter spawn(task<T> t) {
+        return spawn_awaiter{*this, detail::task_group_run(std::move(t), *this)};
+    }
+
+    class join_awaiter {
+    public:
+        explicit join_awaiter(task_group& group) noexcept : group_(group) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // Drop the group's own count; suspend unless every task is done
+        bool await_suspend(std::coroutine_handle<> handle) noexcept {
+            group_.joiner_ = handle;
+            return group_.pending_.fetch_sub(1, std::memory_order_acq_rel) > 1;
+        }
+
+        void await_resume() {
+            group_.pending_.store(1, std::memory_order_relaxed);
+            group_.errors_.failed.store(false, std::memory_order_relaxed);
+            if (std::exception_ptr ex = std::exchange(group_.errors_.exception, nullptr)) {
+                std::rethrow_exception(ex);
+            }
+        }
+
+    private:
+        task_group& group_;
+    };
+
+    join_awaiter join() noexcept { return join_awaiter{*this}; }
+
+    // Cancelled on the first failure, or by cancel()
+    const cancellation_token& token() const noexcept { return token_; }
+
+    void cancel() { token_.cancel(); }
+
+    // Number of spawned tasks that have not finished yet
+    size_t active() const noexcept { return active_.load(std::memory_order_relaxed); }
+
+private:
+    template<typename T>
+    friend detail::task_group_child detail::task_group_run(task<T>, task_group&);
+    friend struct detail::task_group_child::promise_type::final_awaiter;
+
+    void fail(std::exception_ptr ex) {
+        errors_.set_exception(std::move(ex));  // Keeps only the first
+        token_.cancel();
+    }
+
+    void release_slot() {
+        if (limited_) {
+            slots_.release();
+        }
+    }
+
+    // Returns the joiner if this was the last outstanding task
+    std::coroutine_handle<> arrive() noexcept {
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            return joiner_;
+        }
+        return std::noop_coroutine();
+    }
+
+    const bool limited_;
+    async_semaphore slots_;
+    cancellation_token token_;
+    detail::when_all_error errors_;
+    std::atomic<size_t> pending_{1};  // Running tasks + 1 until join()
+    std::atomic<size_t> active_{0};   // Running tasks only, for active()
+    std::coroutine_handle<> joiner_;
+};
+
+namespace detail {
+    inline std::coroutine_handle<> task_group_child::promise_type::final_awaiter::await_suspend(
+        std::coroutine_handle<promise_type> h) noexcept {
+        task_group* group = h.promise().group_;
+        h.destroy();
+        return group->arrive();
+    }
+
+    // The slot is freed before arriving, so a spawner waiting on it does not
+    // wait for the joiner
+    template<typename T>
+    task_group_child task_group_run(task<T> t, task_group& group) {
+        try {
+            co_await std::move(t);
+        } catch (...) {
+            group.fail(std::current_exception());
+        }
+        group.active_.fetch_sub(1, std::memory_order_relaxed);
+        group.release_slot();
+    }
+}
+
+#endif //TASK_DO_TASK_GROUP_H
@@ -0,0 +1,226 @@
+#include "timer_wheel.h"
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+timer_wheel::timer_wheel()
+    : start_(std::chrono::steady_clock::now()),
+      thread_([this] { run(); }) {}
+
+timer_wheel::~timer_wheel() {
+    stop();
+}
+
+void timer_wheel::arm(timer_node& node, std::chrono::milliseconds delay) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return;
+        }
+        if (node.armed) {
+            unlink(node);
+        }
+        if (count_ == 0) {
+            // Nothing is armed, so the wheel can jump straight to the present
+            now_ = std::max(now_, current_tick());
+        }
+
+        // Round up so the timer never fires before `delay` has fully elapsed
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        uint64_t now_ceil = std::chrono::ceil<std::chrono::milliseconds>(elapsed).count();
+        uint64_t ticks = delay.count() > 0 ? static_cast<uint64_t>(delay.count()) : 0;
+
+        node.expiry = std::max(now_ceil + ticks, now_ + 1);
+        node.armed = true;
+        insert(node);
+        ++count_;
+
+        wake = node.expiry < next_wakeup_;
+    }
+    if (wake) {
+        cv_.notify_one();
+    }
+}
+
+bool timer_wheel::cancel(timer_node& node) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!node.armed) {
+        return false;
+    }
+    unlink(node);
+    return true;
+}
+
+void timer_wheel::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+size_t timer_wheel::armed_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+uint64_t timer_wheel::current_tick() const {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+// First tick that needs processing: the next occupied level-0 slot before the
+// wheel wraps, or the wrap itself (where higher levels cascade down)
+uint64_t timer_wheel::next_event_tick() const {
+    uint64_t base = now_ & ~uint64_t{level0_slots - 1};
+    size_t from = static_cast<size_t>(now_ & (level0_slots - 1)) + 1;
+
+    for (size_t word = from / 64; word < occupied0_.size(); ++word) {
+        uint64_t bits = occupied0_[word];
+        if (word == from / 64) {
+            bits &= ~uint64_t{0} << (from % 64);
+        }
+        if (bits) {
+            return base + word * 64 + std::countr_zero(bits);
+        }
+    }
+    return base + level0_slots;
+}
+
+void timer_wheel::insert(timer_node& node) {
+    uint64_t delta = node.expiry - now_;
+
+    if (delta < level0_slots) {
+        node.level = 0;
+        node.slot = static_cast<uint8_t>(node.expiry & (level0_slots - 1));
+        occupied0_[node.slot / 64] |= uint64_t{1} << (node.slot % 64);
+    } else {
+        // Timers beyond the wheel's span wait in the furthest slot and get
+        // re-inserted (with their real expiry) when that slot cascades
+        uint64_t target = delta >= max_span ? now_ + max_span - 1 : node.expiry;
+        delta = target - now_;
+
+        int level = 1;
+        int shift = level0_bits;
+        while (level < levels - 1 && delta >= (uint64_t{1} << (shift + level_bits))) {
+            ++level;
+            shift += level_bits;
+        }
+        node.level = static_cast<uint8_t>(level);
+        node.slot = static_cast<uint8_t>((target >> shift) & (level_slots - 1));
+    }
+
+    timer_node*& list = head(node.level, node.slot);
+    node.prev = nullptr;
+    node.next = list;
+    if (list) {
+        list->prev = &node;
+    }
+    list = &node;
+}
+
+void timer_wheel::unlink(timer_node& node) {
+    timer_node*& list = head(node.level, node.slot);
+    if (node.prev) {
+        node.prev->next = node.next;
+    } else {
+        list = node.next;
+    }
+    if (node.next) {
+        node.next->prev = node.prev;
+    }
+    if (node.level == 0 && !list) {
+        occupied0_[node.slot / 64] &= ~(uint64_t{1} << (node.slot % 64));
+    }
+
+    node.prev = node.next = nullptr;
+    node.armed = false;
+    --count_;
+}
+
+void timer_wheel::cascade(int level, size_t slot) {
+    timer_node* node = head(level, slot);
+    head(level, slot) = nullptr;
+    while (node) {
+        timer_node* next = node->next;
+        insert(*node);
+        node = next;
+    }
+}
+
+// Detach every timer in the current level-0 slot; the returned list is
+// chained through `next`
+timer_node* timer_wheel::expire_current() {
+    size_t slot = static_cast<size_t>(now_ & (level0_slots - 1));
+    timer_node* list = wheel0_[slot];
+    wheel0_[slot] = nullptr;
+    occupied0_[slot / 64] &= ~(uint64_t{1} << (slot % 64));
+
+    for (timer_node* node = list; node; node = node->next) {
+        node->armed = false;
+        --count_;
+    }
+    return list;
+}
+
+void timer_wheel::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stopped_) {
+        if (count_ == 0) {
+            next_wakeup_ = std::numeric_limits<uint64_t>::max();
+            cv_.wait(lock, [this] { return stopped_ || count_ > 0; });
+            continue;
+        }
+
+        timer_node* expired = nullptr;
+        timer_node* tail = nullptr;
+        uint64_t target = current_tick();
+
+        while (now_ < target) {
+            ++now_;
+
+            size_t index = static_cast<size_t>(now_ & (level0_slots - 1));
+            if (index == 0) {
+                int shift = level0_bits;
+                for (int level = 1; level < levels; ++level, shift += level_bits) {
+                    size_t slot = static_cast<size_t>((now_ >> shift) & (level_slots - 1));
+                    cascade(level, slot);
+                    if (slot != 0) {
+                        break;
+                    }
+                }
+            }
+
+            if (timer_node* list = expire_current()) {
+                if (tail) {
+                    tail->next = list;
+                } else {
+                    expired = list;
+                }
+                for (tail = list; tail->next; tail = tail->next) {}
+            }
+        }
+
+        if (expired) {
+            // Run callbacks without the lock so they can re-arm or schedule
+            // freely. A node may be freed as soon as its callback runs.
+            lock.unlock();
+            while (expired) {
+                timer_node* next = expired->next;
+                expired->next = expired->prev = nullptr;
+                expired->callback(*expired);
+                expired = next;
+            }
+            lock.lock();
+            continue;
+        }
+
+        next_wakeup_ = next_event_tick();
+        cv_.wait_until(lock, start_ + std::chrono::milliseconds(next_wakeup_));
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef TASK_DO_TIMER_WHEEL_H
+#define TASK_DO_TIMER_WHEEL_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Intrusive timer entry
+// Awaiters derive from this and must stay at a stable address while armed
+// (a coroutine frame is a good place). callback runs on the timer thread.
+struct timer_node {
+    timer_node() = default;
+    timer_node(const timer_node&) = delete;
+    timer_node& operator=(const timer_node&) = delete;
+
+    void (*callback)(timer_node&) = nullptr;
+
+    // Owned by timer_wheel, guarded by its mutex
+    timer_node* prev = nullptr;
+    timer_node* next = nullptr;
+    uint64_t expiry = 0;
+    uint8_t level = 0;
+    uint8_t slot = 0;
+    bool armed = false;
+};
+
+// Hierarchical timing wheel with 1ms ticks driven by a single thread
+//
+// Level 0 has 256 one-millisecond slots, levels 1-3 have 64 slots each, so
+// the wheel covers 2^26ms (~18.6h) directly; longer timers are parked in the
+// last slot and re-inserted when they cascade. Arming and cancelling are O(1).
+class timer_wheel {
+public:
+    timer_wheel();
+    ~timer_wheel();
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    // Fire node.callback after at least `delay`
+    void arm(timer_node& node, std::chrono::milliseconds delay);
+
+    // Returns true if the timer was disarmed before it fired; false means the
+    // callback has already run or is about to run
+    bool cancel(timer_node& node);
+
+    // Stop the timer thread; timers still armed never fire
+    void stop();
+
+    // Number of armed timers
+    size_t armed_count() const;
+
+private:
+    static constexpr int levels = 4;
+    static constexpr int level0_bits = 8;
+    static constexpr int level_bits = 6;
+    static constexpr size_t level0_slots = size_t{1} << level0_bits;
+    static constexpr size_t level_slots = size_t{1} << level_bits;
+    static constexpr uint64_t max_span = uint64_t{1} << (level0_bits + level_bits * (levels - 1));
+
+    void run();
+    uint64_t current_tick() const;
+    uint64_t next_event_tick() const;
+    void insert(timer_node& node);
+    void unlink(timer_node& node);
+    void cascade(int level, size_t slot);
+    timer_node* expire_current();
+
+    timer_node*& head(int level, size_t slot) {
+        return level == 0 ? wheel0_[slot] : wheels_[level - 1][slot];
+    }
+
+    std::array<timer_node*, level0_slots> wheel0_{};
+    std::array<std::array<timer_node*, level_slots>, levels - 1> wheels_{};
+    std::array<uint64_t, level0_slots / 64> occupied0_{};  // Non-empty level-0 slots
+
+    const std::chrono::steady_clock::time_point start_;
+    uint64_t now_ = 0;                   // Last processed tick
+    uint64_t next_wakeup_ = UINT64_MAX;  // Tick the timer thread sleeps until
+    size_t count_ = 0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::thread thread_;
+};
+
+#endif //TASK_DO_TIMER_WHEEL_H
@@ -6,155 +6,326 @@
 #define TASK_DO_WHEN_ALL_H
 
 #include "task.h"
+#include "executor.h"
+#include <array>
 #include <vector>
+#include <span>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <memory>
 #include <atomic>
-#include <mutex>
-#include <condition_variable>
+#include <optional>
+#include <coroutine>
+#include <exception>
 
 // when_all: Wait for all tasks to complete and return all results
 // TRUE PARALLEL VERSION: All tasks start concurrently
 
 namespace detail {
-    // Shared state for coordinating multiple tasks
-    template<typename T>
-    struct when_all_state {
-        std::vector<T> results;
-        std::atomic<size_t> completed{0};
-        size_t total;
-        std::mutex mutex;
-        std::condition_variable cv;
-        std::exception_ptr exception;
-        
-        when_all_state(size_t n) : total(n) {
-            results.resize(n);
+    // Countdown latch shared by the children of one when_all
+    // The count starts at n + 1: every child arrives once when it finishes and
+    // the parent arrives once after suspending. Whoever arrives last resumes
+    // the parent, so it wakes exactly when the slowest child completes.
+    class when_all_latch {
+    public:
+        explicit when_all_latch(size_t count) noexcept : count_(count + 1) {}
+
+        // Child finished: returns the parent if this was the last arrival
+        std::coroutine_handle<> arrive() noexcept {
+            if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                return parent_;
+            }
+            return std::noop_coroutine();
         }
-        
-        void set_result(size_t index, T&& value) {
-            std::lock_guard lock(mutex);
-            results[index] = std::move(value);
-            completed.fetch_add(1, std::memory_order_release);
-            cv.notify_one();
+
+        // Parent suspended: returns false if every child already finished
+        bool try_await(std::coroutine_handle<> parent) noexcept {
+            parent_ = parent;
+            return count_.fetch_sub(1, std::memory_order_acq_rel) > 1;
         }
-        
-        void set_exception(std::exception_ptr ex) {
-            std::lock_guard lock(mutex);
-            if (!exception) {
-                exception = ex;
+
+    private:
+        std::atomic<size_t> count_;
+        std::coroutine_handle<> parent_;
+    };
+
+    // Coroutine wrapping one child: frees its own frame when it finishes and
+    // resumes straight into the parent (symmetric transfer) if it was the last
+    // to arrive. The parent only owns frames that were never launched.
+    // A child without a latch (see arrive_on_finish) just frees itself.
+    struct when_all_child {
+        struct promise_type {
+            when_all_latch* latch_ = nullptr;
+
+            struct final_awaiter {
+                bool await_ready() noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    when_all_latch* latch = h.promise().latch_;
+                    std::coroutine_handle<> next = latch ? latch->arrive() : std::noop_coroutine();
+                    h.destroy();
+                    return next;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            when_all_child get_return_object() noexcept {
+                return when_all_child{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            final_awaiter final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }  // Bodies catch everything
+
+            static void* operator new(std::size_t size) {
+                return frame_allocator::allocate(size);
+            }
+
+            static void operator delete(void* ptr, std::size_t size) noexcept {
+                frame_allocator::deallocate(ptr, size);
+            }
+        };
+
+        explicit when_all_child(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+        when_all_child(when_all_child&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+        when_all_child& operator=(when_all_child&&) = delete;
+
+        ~when_all_child() {
+            if (handle_) {
+                handle_.destroy();
             }
-            completed.fetch_add(1, std::memory_order_release);
-            cv.notify_one();
         }
-        
-        bool is_done() const {
-            return completed.load(std::memory_order_acquire) >= total;
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    // Awaited inside a when_all_child body (without suspending): the child
+    // will arrive at latch when it finishes
+    struct arrive_on_finish {
+        when_all_latch& latch_;
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<when_all_child::promise_type> h) const noexcept {
+            h.promise().latch_ = &latch_;
+            return false;
         }
+
+        void await_resume() const noexcept {}
     };
-    
-    // Wrapper task that stores result in shared state
+
+    // Schedules every child but the last on the executor, suspends the parent
+    // and runs the last child in its place; the parent resumes once the last
+    // one arrives
+    struct when_all_launch {
+        when_all_latch& latch_;
+        std::span<when_all_child> children_;
+        bool bind_children_ = true;  // false: children opt in via arrive_on_finish
+
+        bool await_ready() const noexcept { return children_.empty(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) {
+            executor& exec = current_executor();
+            for (auto& child : children_) {
+                if (bind_children_) {
+                    child.handle_.promise().latch_ = &latch_;
+                }
+            }
+            std::coroutine_handle<> last = std::exchange(children_.back().handle_, nullptr);
+            if (children_.size() == 2) {
+                // A fork-join split: nothing to batch
+                exec.schedule(std::exchange(children_.front().handle_, nullptr));
+            } else {
+                // One queue operation and at most one wakeup per sleeping worker
+                std::vector<std::coroutine_handle<>> batch;
+                batch.reserve(children_.size() - 1);
+                for (auto& child : children_.first(children_.size() - 1)) {
+                    batch.push_back(std::exchange(child.handle_, nullptr));
+                }
+                exec.schedule_bulk(batch);
+            }
+            if (!latch_.try_await(parent)) {
+                // Only for when_any: a scheduled child already won the race
+                exec.schedule(last);
+                return parent;
+            }
+            return last;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    // First failure among the children of one when_all
+    struct when_all_error {
+        std::atomic<bool> failed{false};
+        std::exception_ptr exception;
+
+        void set_exception(std::exception_ptr ex) noexcept {
+            if (!failed.exchange(true, std::memory_order_relaxed)) {
+                exception = std::move(ex);  // Published to the parent by the latch
+            }
+        }
+    };
+
+    // Completion state for one when_all: each child owns one preallocated
+    // result slot, and only the first failure is kept
     template<typename T>
-    task<void> when_all_task(task<T> t, std::shared_ptr<when_all_state<T>> state, size_t index) {
+    struct when_all_state : when_all_error {
+        when_all_latch latch;
+        std::vector<std::optional<T>> results;
+
+        explicit when_all_state(size_t n) : latch(n), results(n) {}
+    };
+
+    template<>
+    struct when_all_state<void> : when_all_error {
+        when_all_latch latch;
+
+        explicit when_all_state(size_t n) : latch(n) {}
+    };
+
+    // Same for the variadic form: one slot per task type
+    template<typename... Ts>
+    struct when_all_tuple_state : when_all_error {
+        when_all_latch latch{sizeof...(Ts)};
+        std::tuple<std::optional<Ts>...> results;
+    };
+
+    // Wrapper that stores the result in its slot
+    template<typename T>
+    when_all_child when_all_task(task<T> t, when_all_state<T>& state, size_t index) {
+        try {
+            state.results[index].emplace(co_await std::move(t));
+        } catch (...) {
+            state.set_exception(std::current_exception());
+        }
+    }
+
+    inline when_all_child when_all_task(task<void> t, when_all_state<void>& state) {
         try {
-            T result = co_await std::move(t);
-            state->set_result(index, std::move(result));
+            co_await std::move(t);
         } catch (...) {
-            state->set_exception(std::current_exception());
+            state.set_exception(std::current_exception());
         }
     }
 }
 
 template<typename T>
 task<std::vector<T>> when_all(std::vector<task<T>>&& tasks) {
-    co_await schedule_on(get_global_executor());
+    co_await schedule_on(current_executor());
     
     if (tasks.empty()) {
         co_return std::vector<T>{};
     }
     
-    // Create shared state
-    auto state = std::make_shared<detail::when_all_state<T>>(tasks.size());
-    
-    // Launch all tasks concurrently
+    detail::when_all_state<T> state(tasks.size());
+    std::vector<detail::when_all_child> children;
+    children.reserve(tasks.size());
     for (size_t i = 0; i < tasks.size(); ++i) {
-        detail::when_all_task(std::move(tasks[i]), state, i).detach();
+        children.push_back(detail::when_all_task(std::move(tasks[i]), state, i));
     }
     
-    // Wait for all tasks to complete
-    while (!state->is_done()) {
-        co_await async_delay(std::chrono::milliseconds(1));
-    }
+    // Launch all tasks concurrently and resume when the last one finishes
+    co_await detail::when_all_launch{state.latch, children};
     
     // Check for exceptions
-    if (state->exception) {
-        std::rethrow_exception(state->exception);
+    if (state.exception) {
+        std::rethrow_exception(state.exception);
     }
     
-    co_return std::move(state->results);
+    std::vector<T> results;
+    results.reserve(state.results.size());
+    for (auto& slot : state.results) {
+        results.push_back(std::move(*slot));
+    }
+    co_return results;
 }
 
 // when_all for void tasks: Wait for all void tasks to complete
 inline task<void> when_all_void(std::vector<task<void>>&& tasks) {
-    co_await schedule_on(get_global_executor());
+    co_await schedule_on(current_executor());
     
     if (tasks.empty()) {
         co_return;
     }
     
-    std::atomic<size_t> completed{0};
-    size_t total = tasks.size();
-    std::exception_ptr exception;
-    std::mutex mutex;
-    
-    auto wrapper = [&](task<void> t) -> task<void> {
-        try {
-            co_await std::move(t);
-        } catch (...) {
-            std::lock_guard lock(mutex);
-            if (!exception) {
-                exception = std::current_exception();
-            }
-        }
-        completed.fetch_add(1, std::memory_order_release);
-    };
-    
-    // Launch all tasks
+    detail::when_all_state<void> state(tasks.size());
+    std::vector<detail::when_all_child> children;
+    children.reserve(tasks.size());
     for (auto& t : tasks) {
-        wrapper(std::move(t)).detach();
+        children.push_back(detail::when_all_task(std::move(t), state));
     }
     
-    // Wait for completion
-    while (completed.load(std::memory_order_acquire) < total) {
-        co_await async_delay(std::chrono::milliseconds(1));
-    }
+    co_await detail::when_all_launch{state.latch, children};
     
-    if (exception) {
-        std::rethrow_exception(exception);
+    if (state.exception) {
+        std::rethrow_exception(state.exception);
     }
-    
-    co_return;
 }
 
 // when_all for variadic tasks with different types
-// Returns a tuple of results
-// NOTE: This version evaluates tasks sequentially (left-to-right)
-// For true concurrent execution, consider using when_all with vector
+// Returns a tuple of results; all tasks run concurrently, so the total time
+// is that of the slowest one. Result types may be move-only.
 namespace detail {
-    template<typename... Ts>
-    task<std::tuple<Ts...>> when_all_variadic_impl(task<Ts>&&... tasks) {
-        co_await schedule_on(get_global_executor());
+    template<size_t I, typename T, typename... Ts>
+    when_all_child when_all_tuple_task(task<T> t, when_all_tuple_state<Ts...>& state) {
+        try {
+            std::get<I>(state.results).emplace(co_await std::move(t));
+        } catch (...) {
+            state.set_exception(std::current_exception());
+        }
+    }
+
+    // Tasks are taken by value so the frame owns them even if the returned
+    // task is awaited after the argument temporaries are gone
+    template<size_t... Is, typename... Ts>
+    task<std::tuple<Ts...>> when_all_variadic_impl(std::index_sequence<Is...>, task<Ts>... tasks) {
+        co_await schedule_on(current_executor());
+        
+        when_all_tuple_state<Ts...> state;
+        std::array<when_all_child, sizeof...(Ts)> children{when_all_tuple_task<Is>(std::move(tasks), state)...};
+        
+        co_await when_all_launch{state.latch, children};
         
-        // Await each task and construct tuple from results
-        // C++17 guaranteed left-to-right evaluation in braced-init-list
-        co_return std::tuple<Ts...>{co_await std::move(tasks)...};
+        if (state.exception) {
+            std::rethrow_exception(state.exception);
+        }
+        
+        co_return std::tuple<Ts...>{std::move(*std::get<Is>(state.results))...};
+    }
+
+    template<typename... Ts>
+    task<void> when_all_void_variadic_impl(task<Ts>... tasks) {
+        co_await schedule_on(current_executor());
+
+        when_all_state<void> state(sizeof...(Ts));
+        std::array<when_all_child, sizeof...(Ts)> children{when_all_task(std::move(tasks), state)...};
+
+        co_await when_all_launch{state.latch, children};
+
+        if (state.exception) {
+            std::rethrow_exception(state.exception);
+        }
     }
 }
 
 // Variadic when_all: when_all(task1, task2, task3, ...)
 template<typename... Ts>
+    requires (!std::is_void_v<Ts> && ...)
 task<std::tuple<Ts...>> when_all(task<Ts>&&... tasks) {
-    return detail::when_all_variadic_impl(std::move(tasks)...);
+    return detail::when_all_variadic_impl(std::index_sequence_for<Ts...>{}, std::move(tasks)...);
+}
+
+// Same for void tasks: when_all(left, right) for a fork-join split, with no
+// vector and no result tuple
+template<typename... Ts>
+    requires (sizeof...(Ts) > 0 && (std::is_void_v<Ts> && ...))
+task<void> when_all(task<Ts>&&... tasks) {
+    return detail::when_all_void_variadic_impl(std::move(tasks)...);
 }
 
 #endif //TASK_DO_WHEN_ALL_H
@@ -6,55 +6,94 @@
 #define TASK_DO_WHEN_ANY_H
 
 #include "task.h"
+#include "when_all.h"
+#include "cancellation_token.h"
 #include <vector>
 #include <atomic>
 #include <optional>
-#include <mutex>
+#include <memory>
+#include <stdexcept>
+
+namespace detail {
+    // Shared by the parent and every child of one when_any. Children that
+    // lose the race keep running (and keep this alive) until they finish.
+    template<typename T>
+    struct when_any_state {
+        explicit when_any_state(cancellation_token token) : token(std::move(token)) {}
+
+        when_all_latch latch{1};  // The winner and the parent each arrive once
+        std::atomic<bool> claimed{false};
+        cancellation_token token;
+
+        size_t index = 0;
+        std::optional<T> value;
+        std::exception_ptr exception;
+    };
+
+    template<typename T>
+    when_all_child when_any_task(task<T> t, std::shared_ptr<when_any_state<T>> state, size_t index) {
+        std::optional<T> value;
+        std::exception_ptr exception;
+        try {
+            value.emplace(co_await std::move(t));
+        } catch (...) {
+            exception = std::current_exception();
+        }
+
+        if (state->claimed.exchange(true, std::memory_order_acq_rel)) {
+            co_return;  // Lost the race; the result is dropped
+        }
+
+        state->index = index;
+        state->value = std::move(value);
+        state->exception = exception;
+        state->token.cancel();  // Ask the losers to stop
+
+        co_await arrive_on_finish{state->latch};
+    }
+}
 
 // when_any: Wait for the first task to complete and return its result
 // Returns a task that yields a pair<size_t, T> where size_t is the index
+//
+// All tasks start concurrently; the first one to finish (with a value or an
+// exception) wins and resumes the caller right away. `token` is cancelled at
+// that point so losers observing it can stop early; the losers themselves
+// run to completion in the background and their results are discarded.
 template<typename T>
-task<std::pair<size_t, T>> when_any(std::vector<task<T>>&& tasks) {
-    co_await schedule_on(get_global_executor());
-    
+task<std::pair<size_t, T>> when_any(std::vector<task<T>>&& tasks, cancellation_token token) {
+    co_await schedule_on(current_executor());
+
     if (tasks.empty()) {
         throw std::invalid_argument("when_any: empty task list");
     }
-    
-    std::atomic<bool> completed{false};
-    std::mutex result_mutex;
-    std::optional<std::pair<size_t, T>> result;
-    
-    // Start all tasks
-    for (auto& t : tasks) {
-        t.resume();
+
+    auto state = std::make_shared<detail::when_any_state<T>>(std::move(token));
+    std::vector<detail::when_all_child> children;
+    children.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        children.push_back(detail::when_any_task(std::move(tasks[i]), state, i));
     }
-    
-    // Check tasks in order until one completes
-    // This is a simplified implementation; a production version would use proper event notification
-    while (!completed.load()) {
-        for (size_t i = 0; i < tasks.size(); ++i) {
-            if (tasks[i].done()) {
-                if (!completed.exchange(true)) {
-                    // We're the first to notice completion
-                    T value = co_await std::move(tasks[i]);
-                    co_return std::make_pair(i, std::move(value));
-                }
-            }
-        }
-        // Small delay to avoid busy waiting
-        co_await async_delay(std::chrono::milliseconds(1));
+
+    co_await detail::when_all_launch{state->latch, children, false};
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
     }
-    
-    // Should never reach here
-    throw std::runtime_error("when_any: unexpected state");
+
+    co_return std::make_pair(state->index, std::move(*state->value));
+}
+
+template<typename T>
+task<std::pair<size_t, T>> when_any(std::vector<task<T>>&& tasks) {
+    return when_any(std::move(tasks), cancellation_token{});
 }
 
 // Simplified when_any that just returns the first result (without index)
 template<typename T>
 task<T> when_any_value(std::vector<task<T>>&& tasks) {
     auto [index, value] = co_await when_any(std::move(tasks));
-    co_return value;
+    co_return std::move(value);
 }
 
 #endif //TASK_DO_WHEN_ANY_H
@@ -0,0 +1,166 @@
+#ifndef TASK_DO_WORK_STEALING_DEQUE_H
+#define TASK_DO_WORK_STEALING_DEQUE_H
+
+#include <coroutine>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Lock-free Chase-Lev work-stealing deque of coroutine handles
+// (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models")
+//
+// - push() and pop() may only be called by the owning worker
+// - steal() may be called by any thread, including the owner
+//
+// The owner pops LIFO from the bottom, so the handle it just queued (and
+// whose frame is still in cache) runs next; thieves take the oldest from the
+// top. The executor keeps the old end moving by having the owner steal()
+// from its own deque every injection_poll_interval pickups.
+class work_stealing_deque {
+public:
+    explicit work_stealing_deque(size_t capacity = 1024)
+        : buffer_(new ring(round_up(capacity))) {
+        retired_.emplace_back(buffer_.load(std::memory_order_relaxed));
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    // Owner only: append a handle at the bottom, growing the ring if full
+    void push(std::coroutine_handle<> handle) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        ring* r = buffer_.load(std::memory_order_relaxed);
+
+        if (b - t > static_cast<int64_t>(r->capacity) - 1) {
+            r = grow(r, t, b);
+        }
+
+        r->put(b, handle.address());
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only: append a batch with a single publication of bottom
+    void push_bulk(std::span<const std::coroutine_handle<>> handles) {
+        if (handles.empty()) {
+            return;
+        }
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        ring* r = buffer_.load(std::memory_order_relaxed);
+
+        auto n = static_cast<int64_t>(handles.size());
+        while (b - t + n > static_cast<int64_t>(r->capacity)) {
+            r = grow(r, t, b);
+        }
+
+        for (int64_t i = 0; i < n; ++i) {
+            r->put(b + i, handles[static_cast<size_t>(i)].address());
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + n, std::memory_order_relaxed);
+    }
+
+    // Owner only: take the newest handle, or a null handle if empty
+    std::coroutine_handle<> pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        ring* r = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return {};
+        }
+
+        void* address = r->get(b);
+        if (t == b) {
+            // Last element: race any thief for it through top
+            if (!top_.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                address = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return address ? std::coroutine_handle<>::from_address(address) : std::coroutine_handle<>{};
+    }
+
+    // Any thread: take the oldest handle, or a null handle if empty / lost a race
+    std::coroutine_handle<> steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return {};
+        }
+
+        void* address = buffer_.load(std::memory_order_acquire)->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return {};
+        }
+        return std::coroutine_handle<>::from_address(address);
+    }
+
+    // Approximate number of queued handles
+    size_t size() const noexcept {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    struct ring {
+        explicit ring(size_t cap)
+            : capacity(cap), mask(cap - 1), slots(new std::atomic<void*>[cap]) {}
+
+        void put(int64_t i, void* value) noexcept {
+            slots[static_cast<size_t>(i) & mask].store(value, std::memory_order_relaxed);
+        }
+
+        void* get(int64_t i) const noexcept {
+            return slots[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+
+        size_t capacity;
+        size_t mask;
+        std::unique_ptr<std::atomic<void*>[]> slots;
+    };
+
+    static size_t round_up(size_t n) {
+        size_t cap = 2;
+        while (cap < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    // Old rings stay alive until the deque is destroyed: a thief may still be
+    // reading from one after the owner has switched to the larger ring
+    ring* grow(ring* old, int64_t t, int64_t b) {
+        auto* bigger = new ring(old->capacity * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        retired_.emplace_back(bigger);
+        buffer_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    alignas(64) std::atomic<ring*> buffer_;
+    std::vector<std::unique_ptr<ring>> retired_;  // Owner only
+};
+
+#endif //TASK_DO_WORK_STEALING_DEQUE_H
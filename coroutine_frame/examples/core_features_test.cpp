@@ -1,9 +1,31 @@
 #include <print>
+#include <algorithm>
 #include <chrono>
+#include <cerrno>
+#include <filesystem>
+#include <numeric>
+#include <netinet/in.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "../core.h"  // Single include for all functionality!
 
 using namespace std::chrono_literals;
 
+// Checks from Test 5 on are counted, so a failure shows in the exit code
+static int failures = 0;
+
+static void check(bool ok, std::string_view what) {
+    if (ok) {
+        std::println("✓ {}", what);
+    } else {
+        std::println("✗ {}", what);
+        failures++;
+    }
+}
+
 // ============================================================================
 // Test 1: detach() safety
 // ============================================================================
@@ -170,11 +192,1072 @@ task<void> test_error_handling() {
     }
 }
 
+// ============================================================================
+// Test 5: Timer wheel
+// ============================================================================
+
+struct recording_timer : timer_node {
+    int id = 0;
+    std::mutex* mutex = nullptr;
+    std::vector<int>* fired = nullptr;
+
+    static void record(timer_node& node) {
+        auto& self = static_cast<recording_timer&>(node);
+        std::lock_guard<std::mutex> lock(*self.mutex);
+        self.fired->push_back(self.id);
+    }
+};
+
+task<void> test_timer_wheel() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 5: Timer Wheel ===");
+
+    timer_wheel wheel;
+    std::mutex mutex;
+    std::vector<int> fired;
+
+    // Cancelled before its deadline: never fires
+    {
+        recording_timer t;
+        t.id = -1;
+        t.mutex = &mutex;
+        t.fired = &fired;
+        t.callback = &recording_timer::record;
+        wheel.arm(t, 30ms);
+        bool cancelled = wheel.cancel(t);
+        co_await async_delay(60ms);
+        std::lock_guard<std::mutex> lock(mutex);
+        check(cancelled && fired.empty() && wheel.armed_count() == 0,
+              "cancel before the deadline disarms the timer");
+    }
+
+    // Level 0 covers 256ms; later timers start on higher levels and must
+    // still fire in deadline order once they cascade down
+    std::array<recording_timer, 5> timers;
+    constexpr std::array<int, 5> delays_ms = {600, 20, 300, 250, 270};
+    for (size_t i = 0; i < timers.size(); ++i) {
+        timers[i].id = delays_ms[i];
+        timers[i].mutex = &mutex;
+        timers[i].fired = &fired;
+        timers[i].callback = &recording_timer::record;
+        wheel.arm(timers[i], std::chrono::milliseconds(delays_ms[i]));
+    }
+    co_await async_delay(700ms);
+    std::lock_guard<std::mutex> lock(mutex);
+    check(fired == std::vector<int>{20, 250, 270, 300, 600}, "timers fire in deadline order across wheel levels");
+}
+
+// ============================================================================
+// Test 6: Stats histogram and exporters
+// ============================================================================
+
+task<void> test_stats_export() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 6: Stats Histogram and Exporters ===");
+
+    latency_histogram h;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        h.record(v * 1000);  // 1us .. 1ms
+    }
+    auto within = [](uint64_t value, uint64_t expected) {
+        return value >= expected && value <= expected + expected / 16;  // One sub-bucket
+    };
+    check(h.count() == 1000 && within(h.percentile(0.5), 500'000) && within(h.percentile(0.99), 990'000),
+          "histogram percentiles within one sub-bucket");
+    check(h.percentile(1.0) == 1'000'000 && h.max() == 1'000'000, "p100 is the recorded maximum");
+
+    auto bucket_lines = [](const std::string& text) {
+        std::vector<std::string> lines;
+        size_t pos = 0;
+        while ((pos = text.find("_bucket{le=\"", pos)) != std::string::npos) {
+            size_t end = text.find('\n', pos);
+            lines.push_back(text.substr(pos, end - pos));
+            pos = end;
+        }
+        return lines;
+    };
+
+    executor_stats empty;
+    empty.workers.emplace_back();
+    executor_stats busy = empty;
+    busy.workers[0].schedule_latency = h;
+    busy.workers[0].busy_ns = 1'234'567'891;
+    std::string text = busy.to_prometheus();
+    auto empty_lines = bucket_lines(empty.to_prometheus());
+    auto busy_lines = bucket_lines(text);
+
+    bool same_bounds = !busy_lines.empty() && busy_lines.size() == empty_lines.size();
+    for (size_t i = 0; same_bounds && i < busy_lines.size(); ++i) {
+        same_bounds = busy_lines[i].substr(0, busy_lines[i].find('}')) ==
+                      empty_lines[i].substr(0, empty_lines[i].find('}'));
+    }
+    check(same_bounds, "prometheus emits the same bucket set with and without data");
+    check(text.find("_bucket{le=\"1.023e-06\"} 1\n") != std::string::npos &&
+          text.find("_bucket{le=\"0.001048575\"} 1000\n") != std::string::npos &&
+          text.find("_bucket{le=\"+Inf\"} 1000\n") != std::string::npos,
+          "prometheus bucket bounds are exact and cumulative");
+    check(text.find("_busy_seconds_total{worker=\"0\"} 1.234567891\n") != std::string::npos,
+          "prometheus prints seconds with full precision");
+    check(busy.to_json().find("\"count\":1000") != std::string::npos, "json carries the histogram");
+}
+
+// ============================================================================
+// Test 7: Bounded submission queue
+// ============================================================================
+
+task<void> hold_worker(std::atomic<bool>& started, std::atomic<bool>& release) {
+    started = true;
+    while (!release) {
+        std::this_thread::sleep_for(1ms);  // Keeps the only worker busy
+    }
+    co_return;
+}
+
+task<void> no_op() {
+    co_return;
+}
+
+task<void> submit_one(executor& exec, std::atomic<int>& outcome) {
+    co_await schedule_on(get_global_executor());
+    auto job = no_op().release_detached();
+    bool queued = co_await exec.submit(job);
+    if (!queued) {
+        job.destroy();
+    }
+    outcome = queued ? 1 : 0;
+}
+
+void test_bounded_submission() {
+    std::println("\n=== Test 7: Bounded Submission Queue ===");
+
+    executor_config config;
+    config.thread_count = 1;
+    config.injection_capacity = 4;
+    executor exec(config);
+
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    exec.schedule(hold_worker(started, release).release_detached());
+    while (!started) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    // The worker is busy, so nothing drains the ring
+    size_t accepted = 0;
+    while (accepted < 64 && exec.try_schedule(no_op().release_detached())) {
+        accepted++;
+    }
+    auto rejected = no_op().release_detached();
+    bool refused = !exec.try_schedule(rejected);
+    rejected.destroy();
+    check(refused && accepted == 4 && exec.stats().rejected_submissions == 2,
+          "try_schedule returns false once the ring is full");
+
+    // A producer waiting for room gets false from shutdown() instead of hanging
+    std::atomic<int> outcome{-1};
+    submit_one(exec, outcome).detach();
+    std::this_thread::sleep_for(50ms);
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(50ms);
+        release = true;
+    });
+    exec.shutdown();
+    releaser.join();
+    for (int i = 0; i < 100 && outcome == -1; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    check(outcome == 0, "shutdown resumes a waiting submit() with false");
+}
+
+// ============================================================================
+// Test 8: async_spawn futures
+// ============================================================================
+
+task<int> answer_after(std::chrono::milliseconds delay) {
+    co_await async_delay(delay);
+    co_return 42;
+}
+
+task<int> await_spawned() {
+    co_await schedule_on(get_global_executor());
+    int value = co_await async_spawn(answer_after(10ms));
+    try {
+        co_await async_spawn(failing_task());
+        value = -1;
+    } catch (const std::runtime_error&) {
+    }
+    co_return value;
+}
+
+void test_future() {
+    std::println("\n=== Test 8: async_spawn Futures ===");
+
+    auto slow = async_spawn(answer_after(50ms));
+    check(!slow.wait_for(1ms) && !slow.is_ready(), "wait_for times out while the task runs");
+    check(slow.wait_for(2s) && slow.get() == 42, "wait_for and get see the result");
+
+    auto fast = async_spawn(succeeding_task());
+    check(fast.get() == 123, "get blocks until the result is there");
+
+    check(sync_wait(await_spawned()) == 42, "co_await delivers the value and rethrows errors");
+}
+
+// ============================================================================
+// Test 9: Cancellation callbacks
+// ============================================================================
+
+task<void> test_cancellation_callback() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 9: Cancellation Callbacks ===");
+
+    {
+        cancellation_token token;
+        int calls = 0;
+        cancellation_callback cb(token, [&] { calls++; });
+        token.cancel();
+        token.cancel();
+        check(calls == 1, "callback fires once, however often cancel() runs");
+    }
+
+    {
+        cancellation_token token;
+        int calls = 0;
+        {
+            cancellation_callback cb(token, [&] { calls++; });
+        }
+        token.cancel();
+        check(calls == 0, "a destroyed callback is unregistered");
+    }
+
+    {
+        cancellation_token token;
+        token.cancel();
+        int calls = 0;
+        cancellation_callback cb(token, [&] { calls++; });
+        check(calls == 1, "registering on a cancelled token fires at once");
+    }
+
+    cancellation_token token;
+    std::thread canceller([token]() mutable {
+        std::this_thread::sleep_for(20ms);
+        token.cancel();
+    });
+    auto start = std::chrono::steady_clock::now();
+    bool cancelled = false;
+    try {
+        co_await cancellable_delay(10s, token);
+    } catch (const task_cancelled&) {
+        cancelled = true;
+    }
+    canceller.join();
+    check(cancelled && std::chrono::steady_clock::now() - start < 1s, "cancel wakes a suspended delay at once");
+}
+
+// ============================================================================
+// Test 10: Channels
+// ============================================================================
+
+task<bool> send_value(channel<int>& ch, int value) {
+    co_return co_await ch.send(value);
+}
+
+task<void> test_channel() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 10: Channels ===");
+
+    channel<int> ch(2);
+    bool first_sent = co_await ch.send(1);
+    bool second_sent = co_await ch.send(2);
+    auto blocked = async_spawn(send_value(ch, 3));
+    co_await async_delay(20ms);
+    check(first_sent && second_sent && !blocked.is_ready(), "a bounded send waits while the channel is full");
+
+    std::optional<int> first = co_await ch.recv();
+    bool third_sent = co_await blocked;
+    check(first == 1 && third_sent, "recv frees a slot for the waiting sender");
+
+    ch.close();
+    bool late_sent = co_await ch.send(4);
+    std::optional<int> second = co_await ch.recv();
+    std::optional<int> third = co_await ch.recv();
+    std::optional<int> end = co_await ch.recv();
+    check(!late_sent && second == 2 && third == 3 && !end, "close() drains buffered values, then recv returns nullopt");
+}
+
+// ============================================================================
+// Test 11: Mutex, semaphore and event
+// ============================================================================
+
+// Yields inside the critical section so that other workers pile up on it
+task<void> increment_locked(async_mutex& mutex, int& counter, std::atomic<int>& inside, std::atomic<bool>& overlapped) {
+    co_await schedule_on(get_global_executor());
+    for (int i = 0; i < 100; ++i) {
+        auto lock = co_await mutex.scoped_lock();
+        if (inside.fetch_add(1) != 0) {
+            overlapped = true;
+        }
+        co_await yield();
+        counter++;
+        inside.fetch_sub(1);
+    }
+}
+
+task<void> hold_permit(async_semaphore& permits, std::atomic<int>& holders, std::atomic<int>& peak) {
+    co_await schedule_on(get_global_executor());
+    co_await permits.acquire();
+    int now = holders.fetch_add(1) + 1;
+    int seen = peak.load();
+    while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+    }
+    co_await async_delay(5ms);
+    holders.fetch_sub(1);
+    permits.release();
+}
+
+task<void> wait_for_event(async_manual_reset_event& event, std::atomic<int>& woken) {
+    co_await schedule_on(get_global_executor());
+    co_await event;
+    woken++;
+}
+
+task<void> test_async_sync() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 11: Mutex, Semaphore and Event ===");
+
+    async_mutex mutex;
+    int counter = 0;
+    std::atomic<int> inside{0};
+    std::atomic<bool> overlapped{false};
+    std::vector<task<void>> lockers;
+    for (int i = 0; i < 8; ++i) {
+        lockers.push_back(increment_locked(mutex, counter, inside, overlapped));
+    }
+    co_await when_all_void(std::move(lockers));
+    check(counter == 800 && !overlapped, "async_mutex keeps 8 contending tasks out of each other's way");
+
+    async_semaphore permits(3);
+    std::atomic<int> holders{0};
+    std::atomic<int> peak{0};
+    std::vector<task<void>> users;
+    for (int i = 0; i < 12; ++i) {
+        users.push_back(hold_permit(permits, holders, peak));
+    }
+    co_await when_all_void(std::move(users));
+    check(peak.load() <= 3 && permits.available() == 3, "async_semaphore never lets more than 3 of 12 tasks in");
+
+    async_manual_reset_event event;
+    std::atomic<int> woken{0};
+    std::vector<task<void>> waiters;
+    for (int i = 0; i < 4; ++i) {
+        waiters.push_back(wait_for_event(event, woken));
+    }
+    auto all_woken = async_spawn(when_all_void(std::move(waiters)));
+    co_await async_delay(20ms);
+    bool none_early = woken.load() == 0;
+    event.set();
+    co_await all_woken;
+    check(none_early && woken.load() == 4, "set() wakes every waiting task, and none before");
+}
+
+// ============================================================================
+// Test 12: Async generators
+// ============================================================================
+
+struct set_on_exit {
+    bool& flag;
+    ~set_on_exit() { flag = true; }
+};
+
+// Endless: only the consumer decides how many values get produced
+async_generator<int> count_up(int& produced, bool& destroyed) {
+    set_on_exit guard{destroyed};
+    for (int i = 0;; ++i) {
+        co_await yield();
+        produced++;
+        co_yield i;
+    }
+}
+
+task<void> test_async_generator() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 12: Async Generators ===");
+
+    int produced = 0;
+    bool destroyed = false;
+    {
+        auto numbers = count_up(produced, destroyed);
+        check(produced == 0, "the body does not run before next()");
+
+        int sum = 0;
+        for (int taken = 0; taken < 3; ++taken) {
+            int* value = co_await numbers.next();
+            sum += *value;
+        }
+        check(produced == 3 && sum == 0 + 1 + 2, "each next() produces exactly one element");
+    }
+    check(destroyed && produced == 3, "dropping the generator early destroys its body");
+}
+
+// ============================================================================
+// Test 13: Task groups
+// ============================================================================
+
+task<void> test_task_group() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 13: Task Groups ===");
+
+    task_group bounded(4);
+    std::atomic<int> holders{0};
+    std::atomic<int> peak{0};
+    async_semaphore unlimited_permits(100);
+    size_t most_active = 0;
+    bool all_spawned = true;
+    for (int i = 0; i < 20; ++i) {
+        bool spawned = co_await bounded.spawn(hold_permit(unlimited_permits, holders, peak));
+        all_spawned = all_spawned && spawned;
+        most_active = std::max(most_active, bounded.active());
+    }
+    co_await bounded.join();
+    check(all_spawned && peak.load() <= 4 && most_active <= 4, "spawn() keeps at most 4 tasks in flight");
+    check(bounded.active() == 0, "active() is 0 once the group is joined");
+
+    task_group failing;
+    bool spawned_ok = co_await failing.spawn(succeeding_task());
+    bool spawned_bad = co_await failing.spawn(failing_task());
+    std::string error;
+    try {
+        co_await failing.join();
+    } catch (const std::runtime_error& e) {
+        error = e.what();
+    }
+    check(spawned_ok && spawned_bad && error == "Intentional failure" && failing.token().is_cancelled(),
+          "join() rethrows the failure, which cancels the group");
+}
+
+// ============================================================================
+// Test 14: Parallel algorithms
+// ============================================================================
+
+task<void> test_parallel_algorithms() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 14: Parallel Algorithms ===");
+
+    std::vector<long> values(100000);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<long>((i * 7919) % 10007);
+    }
+
+    std::vector<long> squares(values.size());
+    co_await parallel_for(0, values.size(), 0, [&](size_t i) { squares[i] = values[i] * values[i]; });
+    std::vector<long> expected(values.size());
+    std::transform(values.begin(), values.end(), expected.begin(), [](long v) { return v * v; });
+    check(squares == expected, "parallel_for matches std::transform");
+
+    long sum = co_await parallel_reduce(values, 0, 0L, std::plus<>{});
+    check(sum == std::accumulate(values.begin(), values.end(), 0L), "parallel_reduce matches std::accumulate");
+
+    std::vector<std::string> words = {"a", "b", "c", "d", "e", "f", "g", "h"};
+    std::string joined = co_await parallel_reduce(words, 1, std::string(">"), std::plus<>{});
+    check(joined == ">abcdefgh", "parallel_reduce keeps the order of a non-commutative op");
+
+    std::vector<long> sorted = values;
+    co_await parallel_sort(sorted.begin(), sorted.end(), std::less<>{}, 1000);
+    std::vector<long> reference = values;
+    std::sort(reference.begin(), reference.end());
+    check(sorted == reference, "parallel_sort matches std::sort");
+}
+
+// ============================================================================
+// Test 15: Socket I/O
+// ============================================================================
+
+// Loopback listener on an ephemeral port; address receives the port
+static int open_listener(sockaddr_in& address) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(fd, 16) != 0 || ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        throw std::runtime_error("cannot open a loopback listener");
+    }
+    return fd;
+}
+
+// Plain blocking client; loopback connects complete from the backlog
+static int connect_client(const sockaddr_in& address) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        throw std::runtime_error("cannot connect to the loopback listener");
+    }
+    return fd;
+}
+
+static size_t open_fd_count() {
+    auto fds = std::filesystem::directory_iterator("/proc/self/fd");
+    return static_cast<size_t>(std::distance(std::filesystem::begin(fds), std::filesystem::end(fds)));
+}
+
+// True once the peer has closed or reset the connection
+static bool peer_gone(int fd) {
+    pollfd p{fd, POLLIN, 0};
+    char byte;
+    return ::poll(&p, 1, 1000) == 1 && ::recv(fd, &byte, 1, MSG_DONTWAIT) <= 0;
+}
+
+task<ssize_t> recv_into(int fd, char* buffer, size_t size) {
+    co_return co_await async_recv(fd, buffer, size);
+}
+
+task<ssize_t> send_from(int fd, const char* data, size_t size) {
+    co_return co_await async_send(fd, data, size);
+}
+
+task<void> cancel_after(cancellation_token token, std::chrono::milliseconds delay) {
+    co_await async_delay(delay);
+    token.cancel();
+}
+
+task<void> test_socket_io() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 15: Socket I/O ({}) ===", io_backend_name());
+
+    int pair[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair);
+    char buffer[64] = {};
+    ssize_t sent = co_await async_send(pair[0], "ping", 4);
+    ssize_t received = co_await async_recv(pair[1], buffer, sizeof(buffer));
+    check(sent == 4 && received == 4 && std::string_view(buffer, 4) == "ping", "send/recv round trip");
+
+    cancellation_token token;
+    cancel_after(token, 20ms).detach();
+    ssize_t cancelled = co_await async_recv(pair[1], buffer, sizeof(buffer), token);
+    sent = co_await async_send(pair[0], "pong", 4);
+    received = co_await async_recv(pair[1], buffer, sizeof(buffer));
+    check(cancelled == -ECANCELED && sent == 4 && received == 4, "a cancelled recv fails with -ECANCELED, the socket still works");
+
+    close_socket(pair[0]);
+    ssize_t eof = co_await async_recv(pair[1], buffer, sizeof(buffer));
+    check(eof == 0, "recv returns 0 once the peer closed");
+    close_socket(pair[1]);
+
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair);
+    auto pending_recv = async_spawn(recv_into(pair[1], buffer, sizeof(buffer)));
+    co_await async_delay(20ms);
+    close_socket(pair[1]);
+    ssize_t closed_recv = co_await pending_recv;
+    check(closed_recv == -ECANCELED, "close_socket fails a pending recv with -ECANCELED");
+    close_socket(pair[0]);
+
+    // The peer never reads, so the send cannot finish
+    std::vector<char> payload(8 << 20);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i % 251);
+    }
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair);
+    auto pending_send = async_spawn(send_from(pair[0], payload.data(), payload.size()));
+    co_await async_delay(50ms);
+    bool still_sending = !pending_send.is_ready();
+    close_socket(pair[0]);
+    ssize_t closed_send = co_await pending_send;
+    check(still_sending && closed_send == -ECANCELED, "close_socket fails a pending send with -ECANCELED");
+    close_socket(pair[1]);
+
+    // Stalling the reader lets io_uring's multishot recv drain the socket
+    // into provided buffers until they run out (ENOBUFS); the rest has to
+    // come through the direct recv fallback, in order
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair);
+    auto bulk_send = async_spawn(send_from(pair[0], payload.data(), payload.size()));
+    std::vector<char> incoming(payload.size());
+    size_t total = 0;
+    ssize_t first = co_await async_recv(pair[1], incoming.data(), 1);
+    total += first > 0 ? static_cast<size_t>(first) : 0;
+    co_await async_delay(200ms);
+    while (total < incoming.size()) {
+        ssize_t n = co_await async_recv(pair[1], incoming.data() + total, incoming.size() - total);
+        if (n <= 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    ssize_t bulk_sent = co_await bulk_send;
+    check(bulk_sent == static_cast<ssize_t>(payload.size()) && incoming == payload,
+          "8MB arrive intact past a stalled reader");
+    close_socket(pair[0]);
+    close_socket(pair[1]);
+
+    sockaddr_in address;
+    int listener = open_listener(address);
+    int client = connect_client(address);
+    int accepted = static_cast<int>(co_await async_accept(listener));
+    ::send(client, "hello", 5, MSG_NOSIGNAL);
+    received = accepted >= 0 ? co_await async_recv(accepted, buffer, sizeof(buffer)) : -1;
+    check(accepted >= 0 && received == 5 && std::string_view(buffer, 5) == "hello", "async_accept over loopback");
+    close_socket(accepted);
+    ::close(client);
+
+    // Nobody is in async_accept now: clients have to wait in the kernel
+    // backlog instead of being accepted into an unbounded queue
+    size_t fds_before = open_fd_count();
+    std::vector<int> clients;
+    for (int i = 0; i < 8; ++i) {
+        clients.push_back(connect_client(address));
+    }
+    co_await async_delay(50ms);
+    size_t accepted_early = open_fd_count() - fds_before - clients.size();
+    check(accepted_early <= 1, "without an async_accept waiting, connections stay in the backlog");
+
+    close_socket(listener);
+    co_await async_delay(20ms);
+    bool all_gone = true;
+    for (int c : clients) {
+        all_gone = all_gone && peer_gone(c);
+        ::close(c);
+    }
+    check(all_gone && open_fd_count() == fds_before - 1, "closing the listener closes the connections it held");
+
+    // fds past the per-fd tables never reach the backend
+    int beyond = 1 << 21;
+    ssize_t bad_recv = co_await async_recv(-1, buffer, sizeof(buffer));
+    ssize_t big_send = co_await async_send(beyond, buffer, 1);
+    ssize_t big_accept = co_await async_accept(beyond);
+    check(!io_reactor::tracks(beyond) && bad_recv == -EBADF && big_send == -EMFILE && big_accept == -EMFILE,
+          "negative fds fail with -EBADF, fds beyond the tables with -EMFILE");
+}
+
+extern char** environ;
+
+// The backend is picked once per process, so the epoll run is a child
+// process: this binary again, with --io-only and TASK_DO_IO_BACKEND=epoll
+static bool rerun_io_on_epoll() {
+    std::vector<char*> env;
+    for (char** var = environ; *var; ++var) {
+        if (!std::string_view(*var).starts_with("TASK_DO_IO_BACKEND=")) {
+            env.push_back(*var);
+        }
+    }
+    char backend[] = "TASK_DO_IO_BACKEND=epoll";
+    env.push_back(backend);
+    env.push_back(nullptr);
+
+    char self[] = "/proc/self/exe";
+    char io_only[] = "--io-only";
+    char* args[] = {self, io_only, nullptr};
+    std::fflush(stdout);
+    pid_t pid;
+    if (posix_spawn(&pid, self, nullptr, nullptr, args, env.data()) != 0) {
+        return false;
+    }
+    int status = 0;
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// ============================================================================
+// Test 16: Frame allocator
+// ============================================================================
+
+task<int> add_one(int value) {
+    co_return value + 1;
+}
+
+task<int> nested_calls(int depth) {
+    if (depth == 0) {
+        co_return co_await add_one(0);
+    }
+    int below = co_await nested_calls(depth - 1);
+    co_return below + 1;
+}
+
+task<void> test_frame_allocator() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 16: Frame Allocator ===");
+
+    // Warm up this worker's free lists, then run the same shape again
+    for (int i = 0; i < 1000; ++i) {
+        co_await nested_calls(8);
+    }
+    frame_allocator_stats before = frame_allocator::stats();
+    int total = 0;
+    for (int i = 0; i < 10000; ++i) {
+        total += co_await nested_calls(8);
+    }
+    frame_allocator_stats after = frame_allocator::stats();
+    check(total == 10000 * 9 && after.heap_allocations == before.heap_allocations,
+          "steady-state nested tasks never reach the heap");
+    check(after.frames_recycled - before.frames_recycled >= 10000 * 10, "every frame comes from a free list");
+
+    // Unstarted tasks own their frames: destroying them elsewhere frees remotely
+    std::vector<task<int>> frames;
+    for (int i = 0; i < 100; ++i) {
+        frames.push_back(add_one(i));
+    }
+    before = frame_allocator::stats();
+    std::thread([&frames] { frames.clear(); }).join();
+    after = frame_allocator::stats();
+    check(after.remote_frees - before.remote_frees >= 100, "frames freed on another thread count as remote frees");
+}
+
+// ============================================================================
+// Test 17: Work-stealing deque
+// ============================================================================
+
+// Stand-in handles: never resumed, only counted. Item i is address 8 * i.
+static std::coroutine_handle<> fake_handle(size_t item) {
+    return std::coroutine_handle<>::from_address(reinterpret_cast<void*>(item * 8));
+}
+
+static size_t fake_item(std::coroutine_handle<> handle) {
+    return reinterpret_cast<uintptr_t>(handle.address()) / 8;
+}
+
+// One owner pushes (singly and in bulk) and pops while three thieves steal;
+// every item must be taken exactly once
+static bool deque_stress(size_t items, size_t pop_every) {
+    work_stealing_deque deque(8);  // Small, so the ring has to grow
+    std::vector<std::atomic<int>> taken(items + 1);
+    std::atomic<bool> done{false};
+    auto take = [&](std::coroutine_handle<> handle) {
+        if (handle) {
+            taken[fake_item(handle)].fetch_add(1, std::memory_order_relaxed);
+        }
+        return static_cast<bool>(handle);
+    };
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; ++i) {
+        thieves.emplace_back([&] {
+            while (!done.load(std::memory_order_acquire)) {
+                take(deque.steal());
+            }
+        });
+    }
+    std::vector<std::coroutine_handle<>> batch;
+    for (size_t item = 1; item <= items; ++item) {
+        if (item % 64 < 16) {
+            batch.push_back(fake_handle(item));
+            if (batch.size() == 16) {
+                deque.push_bulk(batch);
+                batch.clear();
+            }
+        } else {
+            deque.push(fake_handle(item));
+        }
+        if (item % pop_every == 0) {
+            take(deque.pop());
+        }
+    }
+    deque.push_bulk(batch);
+    while (take(deque.pop())) {
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+    while (take(deque.steal())) {
+    }
+    for (size_t item = 1; item <= items; ++item) {
+        if (taken[item].load() != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_work_stealing_deque() {
+    std::println("\n=== Test 17: Work-Stealing Deque ===");
+
+    bool mixed = true;
+    for (int round = 0; round < 5; ++round) {
+        mixed = mixed && deque_stress(100000, 3);
+    }
+    check(mixed, "owner push/push_bulk/pop against 3 thieves: every item taken once, across ring growth");
+
+    // Popping after every push keeps the deque at one element, so nearly
+    // every pop races the thieves for the last one
+    bool last_element = true;
+    for (int round = 0; round < 5; ++round) {
+        last_element = last_element && deque_stress(100000, 1);
+    }
+    check(last_element, "pop and steal racing for the last element never both win");
+}
+
+// ============================================================================
+// Test 18: Priority lanes
+// ============================================================================
+
+// Always goes back through the executor on the given lane (schedule_on is
+// a no-op when already there)
+struct requeue_on {
+    executor& exec;
+    priority lane;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { exec.schedule(handle, lane); }
+    void await_resume() const noexcept {}
+};
+
+struct lane_race {
+    std::atomic<int> hog_resumes{0};
+    int hog_resumes_seen = -1;  // By the probe, when it finally ran
+    std::atomic<int> remaining{5};
+    async_manual_reset_event finished;
+
+    void arrive() {
+        if (remaining.fetch_sub(1) == 1) {
+            finished.set();
+        }
+    }
+};
+
+task<void> lane_hog(executor& exec, priority lane, lane_race& race) {
+    for (int i = 0; i < 2000; ++i) {
+        co_await requeue_on{exec, lane};
+        race.hog_resumes++;
+    }
+    race.arrive();
+}
+
+task<void> lane_probe(executor& exec, priority lane, lane_race& race) {
+    co_await requeue_on{exec, lane};
+    race.hog_resumes_seen = race.hog_resumes.load();
+    race.arrive();
+}
+
+// Four hogs keep requeueing on hog_lane while one probe hops once on the
+// other lane; returns how many hog resumes ran before the probe did
+task<int> run_lane_race(executor& exec, priority hog_lane, priority probe_lane) {
+    co_await schedule_on(exec);
+    lane_race race;
+    for (int i = 0; i < 4; ++i) {
+        lane_hog(exec, hog_lane, race).detach();
+    }
+    lane_probe(exec, probe_lane, race).detach();
+    co_await race.finished;
+    co_return race.hog_resumes_seen;
+}
+
+void test_priority_lanes() {
+    std::println("\n=== Test 18: Priority Lanes ===");
+
+    executor lanes(1);  // One worker, so every pickup is a choice between lanes
+    int high_before_normal = sync_wait(run_lane_race(lanes, priority::high, priority::normal));
+    check(high_before_normal >= 0 && high_before_normal <= 16,
+          "a normal task runs within 16 resumes of a flooded high lane");
+    int normal_before_high = sync_wait(run_lane_race(lanes, priority::normal, priority::high));
+    check(normal_before_high >= 0 && normal_before_high <= 1, "a high hop overtakes a saturated normal lane");
+    std::println("  probe ran after {} high / {} normal resumes", high_before_normal, normal_before_high);
+    lanes.shutdown();
+}
+
+// ============================================================================
+// Test 19: Bulk scheduling
+// ============================================================================
+
+// Suspends and hands the handle out instead of scheduling it
+struct park_handle {
+    std::vector<std::coroutine_handle<>>& parked;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { parked.push_back(handle); }
+    void await_resume() const noexcept {}
+};
+
+struct bulk_batch {
+    std::vector<std::coroutine_handle<>> parked;
+    std::vector<std::atomic<int>> runs;
+    std::atomic<size_t> remaining;
+    async_manual_reset_event finished;
+
+    explicit bulk_batch(size_t count) : runs(count), remaining(count) { parked.reserve(count); }
+};
+
+task<void> bulk_member(bulk_batch& batch, size_t index) {
+    co_await park_handle{batch.parked};
+    batch.runs[index]++;
+    if (batch.remaining.fetch_sub(1) == 1) {
+        batch.finished.set();
+    }
+}
+
+// Parks `count` coroutines, hands them all to one schedule_bulk() call from
+// a worker of pool or from a fresh outside thread, and checks each ran once
+task<bool> run_bulk_batch(executor& pool, size_t count, priority lane, bool from_worker) {
+    if (from_worker) {
+        co_await schedule_on(pool);
+    }
+    bulk_batch batch(count);
+    for (size_t i = 0; i < count; ++i) {
+        bulk_member(batch, i).detach();  // Runs inline up to park_handle
+    }
+    if (from_worker) {
+        pool.schedule_bulk(batch.parked, lane);
+    } else {
+        std::thread([&] { pool.schedule_bulk(batch.parked, lane); }).join();
+    }
+    co_await batch.finished;
+    co_return std::ranges::all_of(batch.runs, [](const std::atomic<int>& r) { return r.load() == 1; });
+}
+
+void test_schedule_bulk() {
+    std::println("\n=== Test 19: Bulk Scheduling ===");
+
+    executor pool(4);
+    // A lost handle would leave the batch waiting forever: fail, don't hang
+    auto batch_ok = [&](priority lane, bool from_worker) {
+        auto batch = async_spawn(run_bulk_batch(pool, 20000, lane, from_worker));
+        return batch.wait_for(10s) && batch.get();
+    };
+    check(batch_ok(priority::normal, true), "a bulk batch from a worker runs every handle exactly once");
+    check(batch_ok(priority::normal, false), "a bulk batch from an outside thread runs every handle exactly once");
+    check(batch_ok(priority::high, true), "a high-lane bulk batch from a worker runs every handle exactly once");
+    check(batch_ok(priority::high, false),
+          "a high-lane bulk batch from an outside thread runs every handle exactly once");
+    pool.shutdown();
+}
+
+// ============================================================================
+// Test 20: Idle policies
+// ============================================================================
+
+task<int> hop_and_answer(executor& pool) {
+    co_await schedule_on(pool);
+    co_return 7;
+}
+
+bool all_workers_parked(const executor& pool) {
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto snapshot = pool.stats();
+        if (std::ranges::all_of(snapshot.workers, [](const worker_stats& w) { return w.parks > 0; })) {
+            return true;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return false;
+}
+
+// Schedules onto the pool from outside, alternately once its workers are
+// asleep again and right as they head back to sleep; false at the first
+// task that does not run in time (a lost wakeup)
+bool wakes_every_time(executor& pool, int rounds) {
+    for (int round = 0; round < rounds; ++round) {
+        if (round % 2 == 0) {
+            std::this_thread::sleep_for(1ms);
+        }
+        auto answer = async_spawn(hop_and_answer(pool));
+        if (!answer.wait_for(2s) || answer.get() != 7) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_idle_policies() {
+    std::println("\n=== Test 20: Idle Policies ===");
+
+    std::pair<std::string_view, idle_policy> policies[] = {
+        {"low_cpu", idle_policy::low_cpu()},
+        {"low_latency", idle_policy::low_latency()},
+    };
+    for (auto [name, policy] : policies) {
+        executor_config config;
+        config.thread_count = 2;
+        config.idle = policy;
+        executor pool(config);
+
+        std::println("  {}:", name);
+        check(all_workers_parked(pool), "idle workers park");
+        check(wakes_every_time(pool, 400), "work scheduled from outside wakes a parked worker");
+        pool.shutdown();
+    }
+}
+
+// ============================================================================
+// Test 21: when_any
+// ============================================================================
+
+// Losers count themselves once they notice the cancellation; shared, since
+// they outlive the when_any that started them
+using cancel_count = std::shared_ptr<std::atomic<int>>;
+
+task<int> sleeping_racer(cancellation_token token, cancel_count noticed) {
+    try {
+        co_await cancellable_delay(10s, token);
+    } catch (const task_cancelled&) {
+        (*noticed)++;
+    }
+    co_return 1;
+}
+
+task<int> polling_racer(cancellation_token token, cancel_count noticed) {
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (token.is_cancelled()) {
+            (*noticed)++;
+            break;
+        }
+        co_await yield();
+    }
+    co_return 2;
+}
+
+task<int> winning_racer() {
+    co_await async_delay(20ms);
+    co_return 42;
+}
+
+task<void> test_when_any() {
+    co_await schedule_on(get_global_executor());
+
+    std::println("\n=== Test 21: when_any ===");
+
+    cancellation_token token;
+    auto noticed = std::make_shared<std::atomic<int>>(0);
+    std::vector<task<int>> racers;
+    racers.push_back(sleeping_racer(token, noticed));
+    racers.push_back(polling_racer(token, noticed));
+    racers.push_back(winning_racer());
+
+    auto start = std::chrono::steady_clock::now();
+    auto [index, value] = co_await when_any(std::move(racers), token);
+    check(index == 2 && value == 42, "when_any returns the first finisher's index and value");
+    check(std::chrono::steady_clock::now() - start < 1s, "when_any resumes without waiting for the losers");
+    check(token.is_cancelled(), "the token is cancelled once the winner finishes");
+
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (noticed->load() < 2 && std::chrono::steady_clock::now() < deadline) {
+        co_await async_delay(1ms);
+    }
+    check(noticed->load() == 2, "both losers observe the cancellation and stop early");
+}
+
 // ============================================================================
 // Main
 // ============================================================================
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string_view(argv[1]) == "--io-only") {
+        try {
+            sync_wait(test_socket_io());
+        } catch (const std::exception& e) {
+            std::println("\n❌ Test failed: {}", e.what());
+            failures++;
+        }
+        get_global_executor().shutdown();
+        return failures == 0 ? 0 : 1;
+    }
+
     std::println("╔════════════════════════════════════════════╗");
     std::println("║   Core Features Test Suite                ║");
     std::println("╚════════════════════════════════════════════╝");
@@ -187,21 +1270,78 @@ int main() {
         sync_wait(test_parallel_when_all());
         
         // Test 3: Timeout
-        // sync_wait(test_timeout());  // Skip for now due to implementation limitations
-        std::println("\n=== Test 3: Timeout Support ===");
-        std::println("(Skipped - needs when_any improvements)");
+        sync_wait(test_timeout());
         
         // Test 4: Error handling
         sync_wait(test_error_handling());
         
-        std::println("\n╔════════════════════════════════════════════╗");
-        std::println("║   ✅ All Tests Passed!                     ║");
-        std::println("╚════════════════════════════════════════════╝");
+        // Test 5: Timer wheel
+        sync_wait(test_timer_wheel());
+
+        // Test 6: Stats export
+        sync_wait(test_stats_export());
+
+        // Test 7: Bounded submission queue
+        test_bounded_submission();
+
+        // Test 8: Futures
+        test_future();
+
+        // Test 9: Cancellation callbacks
+        sync_wait(test_cancellation_callback());
+
+        // Test 10: Channels
+        sync_wait(test_channel());
+
+        // Test 11: Mutex, semaphore and event
+        sync_wait(test_async_sync());
+
+        // Test 12: Async generators
+        sync_wait(test_async_generator());
+
+        // Test 13: Task groups
+        sync_wait(test_task_group());
+
+        // Test 14: Parallel algorithms
+        sync_wait(test_parallel_algorithms());
+
+        // Test 15: Socket I/O
+        sync_wait(test_socket_io());
+        if (std::string_view(io_backend_name()) != "epoll") {
+            check(rerun_io_on_epoll(), "the socket I/O checks pass on the epoll backend too");
+        }
+
+        // Test 16: Frame allocator
+        sync_wait(test_frame_allocator());
+
+        // Test 17: Work-stealing deque
+        test_work_stealing_deque();
+
+        // Test 18: Priority lanes
+        test_priority_lanes();
+
+        // Test 19: Bulk scheduling
+        test_schedule_bulk();
+
+        // Test 20: Idle policies
+        test_idle_policies();
+
+        // Test 21: when_any
+        sync_wait(test_when_any());
+
+        if (failures == 0) {
+            std::println("\n╔════════════════════════════════════════════╗");
+            std::println("║   ✅ All Tests Passed!                     ║");
+            std::println("╚════════════════════════════════════════════╝");
+        } else {
+            std::println("\n❌ {} check(s) failed", failures);
+        }
         
     } catch (const std::exception& e) {
         std::println("\n❌ Test failed: {}", e.what());
+        failures++;
     }
     
     get_global_executor().shutdown();
-    return 0;
+    return failures == 0 ? 0 : 1;
 }
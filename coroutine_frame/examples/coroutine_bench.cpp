@@ -0,0 +1,545 @@
+// Benchmarks for the core primitives
+//
+// Usage: coroutine_bench [--json] [--quick] [--filter <substring>]
+//   --json    one JSON object per line, for tracking regressions across runs
+//   --quick   fewer repetitions (fan-out sizes stay the same)
+//   --filter  only run benchmarks whose name contains the substring
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../core.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct options {
+    bool json = false;
+    bool quick = false;
+    const char* filter = nullptr;
+};
+
+options opts;
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// One line of output
+struct bench_result {
+    std::string name;
+    std::string variant;
+    size_t workers = 0;
+    uint64_t ops = 0;
+    uint64_t elapsed_ns = 0;
+    latency_histogram latency;  // What a sample means is per benchmark
+};
+
+void report(const bench_result& r) {
+    double seconds = static_cast<double>(r.elapsed_ns) / 1e9;
+    double ops_per_sec = seconds > 0 ? static_cast<double>(r.ops) / seconds : 0;
+    uint64_t p50 = r.latency.percentile(0.5);
+    uint64_t p99 = r.latency.percentile(0.99);
+
+    if (opts.json) {
+        std::printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"workers\":%zu,\"ops\":%llu,"
+                    "\"seconds\":%.6f,\"ops_per_sec\":%.1f,\"samples\":%llu,"
+                    "\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}\n",
+                    r.name.c_str(), r.variant.c_str(), r.workers,
+                    static_cast<unsigned long long>(r.ops), seconds, ops_per_sec,
+                    static_cast<unsigned long long>(r.latency.count()),
+                    static_cast<unsigned long long>(p50), static_cast<unsigned long long>(p99),
+                    static_cast<unsigned long long>(r.latency.max()));
+    } else {
+        std::printf("%-16s %-22s %3zu workers %14.0f ops/s   p50 %10llu ns   p99 %10llu ns\n",
+                    r.name.c_str(), r.variant.c_str(), r.workers, ops_per_sec,
+                    static_cast<unsigned long long>(p50), static_cast<unsigned long long>(p99));
+    }
+    std::fflush(stdout);
+}
+
+bool selected(const char* name) {
+    return !opts.filter || std::strstr(name, opts.filter) != nullptr;
+}
+
+size_t reps(size_t full) {
+    return opts.quick ? std::max<size_t>(1, full / 10) : full;
+}
+
+// Blocks a non-worker thread until `count` arrivals
+struct countdown {
+    std::atomic<size_t> left;
+    std::atomic<uint32_t> done{0};
+
+    explicit countdown(size_t count) : left(count) {}
+
+    void arrive() {
+        if (left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done.store(1, std::memory_order_release);
+            done.notify_one();
+        }
+    }
+
+    void wait() {
+        while (done.load(std::memory_order_acquire) == 0) {
+            done.wait(0, std::memory_order_acquire);
+        }
+    }
+};
+
+// Bare coroutine that runs once when scheduled and frees itself, so the
+// schedule benchmarks measure the executor and not task<T> bookkeeping
+struct bench_op {
+    struct promise_type {
+        bench_op get_return_object() noexcept {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        static void* operator new(size_t size) { return frame_allocator::allocate(size); }
+        static void operator delete(void* ptr, size_t size) noexcept {
+            frame_allocator::deallocate(ptr, size);
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// `slot` holds the schedule time on entry and the schedule -> resume delay on exit
+bench_op timed_tick(uint64_t& slot, countdown& done) {
+    slot = now_ns() - slot;
+    done.arrive();
+    co_return;
+}
+
+// Roughly a microsecond of work that the optimizer cannot drop
+bench_op busy_tick(uint64_t& slot, countdown& done) {
+    slot = now_ns() - slot;
+    uint64_t x = slot | 1;
+    for (int i = 0; i < 400; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if (x == 0) {
+        std::printf("unreachable\n");
+    }
+    done.arrive();
+    co_return;
+}
+
+// Schedules every op from inside a worker, so they go to its local deque
+bench_op producer(executor& exec, std::vector<bench_op>& ops, std::vector<uint64_t>& slots) {
+    for (size_t i = 0; i < ops.size(); ++i) {
+        slots[i] = now_ns();
+        exec.schedule(ops[i].handle);
+    }
+    co_return;
+}
+
+// Same, but hands the whole batch over with one schedule_bulk()
+bench_op bulk_producer(executor& exec, std::vector<bench_op>& ops, std::vector<uint64_t>& slots) {
+    std::vector<std::coroutine_handle<>> batch;
+    batch.reserve(ops.size());
+    for (auto& op : ops) {
+        batch.push_back(op.handle);
+    }
+    uint64_t now = now_ns();
+    for (auto& slot : slots) {
+        slot = now;
+    }
+    exec.schedule_bulk(batch);
+    co_return;
+}
+
+latency_histogram histogram_of(const std::vector<uint64_t>& samples) {
+    latency_histogram h;
+    for (uint64_t s : samples) {
+        h.record(s);
+    }
+    return h;
+}
+
+enum class source {
+    worker,       // schedule() one by one from a worker
+    worker_bulk,  // one schedule_bulk() from a worker
+    outside,      // schedule() one by one from this thread
+};
+
+// N ops of `make` scheduled on `exec`
+template<typename MakeOp>
+bench_result run_fanout(executor& exec, size_t n, source from, MakeOp make) {
+    std::vector<uint64_t> slots(n);
+    std::vector<bench_op> ops;
+    ops.reserve(n);
+    countdown done(n);
+    for (size_t i = 0; i < n; ++i) {
+        ops.push_back(make(slots[i], done));
+    }
+
+    bench_result r;
+    r.workers = exec.thread_count();
+    r.ops = n;
+    uint64_t start = now_ns();
+    if (from == source::worker) {
+        exec.schedule(producer(exec, ops, slots).handle);
+    } else if (from == source::worker_bulk) {
+        exec.schedule(bulk_producer(exec, ops, slots).handle);
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            slots[i] = now_ns();
+            exec.schedule(ops[i].handle);
+        }
+    }
+    done.wait();
+    r.elapsed_ns = now_ns() - start;
+    r.latency = histogram_of(slots);
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// schedule: raw executor throughput, latency = schedule() -> resume
+// ---------------------------------------------------------------------------
+
+void bench_schedule() {
+    executor& exec = get_global_executor();
+    const size_t n = opts.quick ? 100'000 : 1'000'000;
+
+    bench_result r = run_fanout(exec, n, source::worker, timed_tick);
+    r.name = "schedule";
+    r.variant = "from_worker";
+    report(r);
+
+    r = run_fanout(exec, n, source::worker_bulk, timed_tick);
+    r.name = "schedule";
+    r.variant = "bulk_from_worker";
+    report(r);
+
+    r = run_fanout(exec, n, source::outside, timed_tick);
+    r.name = "schedule";
+    r.variant = "from_outside";
+    report(r);
+}
+
+// ---------------------------------------------------------------------------
+// nested_await: co_await chains of task<T>, latency = one whole chain
+// ---------------------------------------------------------------------------
+
+task<uint64_t> chain(int depth) {
+    if (depth == 0) {
+        co_return 1;
+    }
+    co_return 1 + co_await chain(depth - 1);
+}
+
+task<bench_result> nested_await_case(int depth, size_t iterations) {
+    co_await schedule_on(get_global_executor());
+
+    bench_result r;
+    uint64_t total = 0;
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < iterations; ++i) {
+        uint64_t t0 = now_ns();
+        total += co_await chain(depth);
+        r.latency.record(now_ns() - t0);
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.ops = total;  // Frames created and awaited
+    co_return r;
+}
+
+void bench_nested_await() {
+    for (int depth : {1, 16, 256}) {
+        size_t iterations = reps(2'000'000 / static_cast<size_t>(depth));
+        bench_result r = sync_wait(nested_await_case(depth, iterations));
+        r.name = "nested_await";
+        r.variant = "depth=" + std::to_string(depth);
+        r.workers = get_global_executor().thread_count();
+        report(r);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// when_all: fan-out of trivial tasks, latency = one whole when_all
+// ---------------------------------------------------------------------------
+
+task<int> leaf(int value) {
+    co_return value;
+}
+
+task<bench_result> when_all_case(size_t fanout, size_t repetitions) {
+    co_await schedule_on(get_global_executor());
+
+    bench_result r;
+    uint64_t start = now_ns();
+    for (size_t rep = 0; rep < repetitions; ++rep) {
+        uint64_t t0 = now_ns();
+        std::vector<task<int>> tasks;
+        tasks.reserve(fanout);
+        for (size_t i = 0; i < fanout; ++i) {
+            tasks.push_back(leaf(static_cast<int>(i)));
+        }
+        auto results = co_await when_all(std::move(tasks));
+        if (results.size() != fanout) {
+            std::fprintf(stderr, "[bench] when_all returned %zu of %zu results\n", results.size(), fanout);
+        }
+        r.latency.record(now_ns() - t0);
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.ops = fanout * repetitions;  // Child tasks completed
+    co_return r;
+}
+
+void bench_when_all() {
+    struct size_case {
+        size_t fanout;
+        size_t repetitions;
+    };
+    for (auto [fanout, repetitions] : {size_case{1'000, 500}, size_case{100'000, 20}, size_case{1'000'000, 5}}) {
+        bench_result r = sync_wait(when_all_case(fanout, reps(repetitions)));
+        r.name = "when_all";
+        r.variant = "fanout=" + std::to_string(fanout);
+        r.workers = get_global_executor().thread_count();
+        report(r);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// sync_wait: round trip from a plain thread into the pool and back
+// ---------------------------------------------------------------------------
+
+task<int> trivial() {
+    co_return 1;
+}
+
+void bench_sync_wait() {
+    const size_t iterations = reps(50'000);
+    bench_result r;
+    r.name = "sync_wait";
+    r.variant = "round_trip";
+    r.workers = get_global_executor().thread_count();
+    r.ops = iterations;
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < iterations; ++i) {
+        uint64_t t0 = now_ns();
+        sync_wait(trivial());
+        r.latency.record(now_ns() - t0);
+    }
+    r.elapsed_ns = now_ns() - start;
+    report(r);
+}
+
+// ---------------------------------------------------------------------------
+// async_delay: lateness of delays while every worker is kept busy
+// ---------------------------------------------------------------------------
+
+task<void> background_load(const std::atomic<bool>& stop, countdown& finished) {
+    co_await schedule_on(get_global_executor());
+    while (!stop.load(std::memory_order_relaxed)) {
+        auto until = std::chrono::steady_clock::now() + 20us;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+        co_await yield();
+    }
+    finished.arrive();
+}
+
+task<void> timed_delay(std::chrono::milliseconds duration, uint64_t& lateness) {
+    co_await schedule_on(get_global_executor());
+    uint64_t start = now_ns();
+    co_await async_delay(duration);
+    uint64_t elapsed = now_ns() - start;
+    auto wanted = static_cast<uint64_t>(std::chrono::nanoseconds(duration).count());
+    lateness = elapsed > wanted ? elapsed - wanted : 0;
+}
+
+void bench_async_delay() {
+    executor& exec = get_global_executor();
+    const size_t load_tasks = exec.thread_count() * 4;
+    const size_t delays = reps(2'000);
+
+    std::atomic<bool> stop{false};
+    countdown load_finished(load_tasks);
+    for (size_t i = 0; i < load_tasks; ++i) {
+        background_load(stop, load_finished).detach();
+    }
+
+    std::vector<uint64_t> lateness(delays);
+    std::vector<task<void>> tasks;
+    tasks.reserve(delays);
+    for (size_t i = 0; i < delays; ++i) {
+        tasks.push_back(timed_delay(std::chrono::milliseconds(1 + i % 50), lateness[i]));
+    }
+
+    bench_result r;
+    r.name = "async_delay";
+    r.variant = "lateness_under_load";
+    r.workers = exec.thread_count();
+    r.ops = delays;
+    uint64_t start = now_ns();
+    sync_wait(when_all_void(std::move(tasks)));
+    r.elapsed_ns = now_ns() - start;
+
+    stop.store(true, std::memory_order_relaxed);
+    load_finished.wait();
+
+    r.latency = histogram_of(lateness);
+    report(r);
+}
+
+// ---------------------------------------------------------------------------
+// priority: latency of a hop onto the pool from outside while it is saturated
+// with normal priority work
+// ---------------------------------------------------------------------------
+
+task<void> timed_hop(priority lane, std::atomic<uint64_t>& latency) {
+    uint64_t start = now_ns();
+    co_await schedule_on(get_global_executor(), lane);
+    latency.store(std::max<uint64_t>(1, now_ns() - start), std::memory_order_release);
+    latency.notify_one();
+}
+
+void bench_priority() {
+    executor& exec = get_global_executor();
+    const size_t load_tasks = exec.thread_count() * 4;
+    const size_t hops = reps(2'000);
+
+    std::atomic<bool> stop{false};
+    countdown load_finished(load_tasks);
+    for (size_t i = 0; i < load_tasks; ++i) {
+        background_load(stop, load_finished).detach();
+    }
+
+    for (priority lane : {priority::normal, priority::high}) {
+        bench_result r;
+        r.name = "priority";
+        r.variant = lane == priority::high ? "high_hop_under_load" : "normal_hop_under_load";
+        r.workers = exec.thread_count();
+        r.ops = hops;
+        uint64_t start = now_ns();
+        for (size_t i = 0; i < hops; ++i) {
+            std::atomic<uint64_t> latency{0};
+            timed_hop(lane, latency).detach();  // Runs inline up to the hop
+            while (latency.load(std::memory_order_acquire) == 0) {
+                latency.wait(0, std::memory_order_acquire);
+            }
+            r.latency.record(latency.load(std::memory_order_relaxed));
+        }
+        r.elapsed_ns = now_ns() - start;
+        report(r);
+    }
+
+    stop.store(true, std::memory_order_relaxed);
+    load_finished.wait();
+}
+
+// ---------------------------------------------------------------------------
+// wakeup: schedule() -> resume on a quiet pool, per idle policy
+// ---------------------------------------------------------------------------
+
+void bench_wakeup() {
+    struct policy_case {
+        const char* name;
+        idle_policy policy;
+    };
+    const size_t wakeups = reps(500);
+    for (auto [name, policy] : {policy_case{"low_cpu", idle_policy::low_cpu()},
+                                policy_case{"low_latency", idle_policy::low_latency()}}) {
+        executor_config config;
+        config.thread_count = 2;
+        config.idle = policy;
+        executor exec(config);
+
+        bench_result r;
+        r.name = "wakeup";
+        r.variant = name;
+        r.workers = exec.thread_count();
+        r.ops = wakeups;
+        uint64_t start = now_ns();
+        for (size_t i = 0; i < wakeups; ++i) {
+            std::this_thread::sleep_for(200us);  // Let the workers go idle
+            uint64_t slot = 0;
+            countdown done(1);
+            bench_op op = timed_tick(slot, done);
+            slot = now_ns();
+            exec.schedule(op.handle);
+            done.wait();
+            r.latency.record(slot);
+        }
+        r.elapsed_ns = now_ns() - start;
+        report(r);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// scaling: ~1us jobs spread by work stealing over 1..N workers
+// ---------------------------------------------------------------------------
+
+void bench_scaling() {
+    size_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t w = 1; w < max_workers; w *= 2) {
+        counts.push_back(w);
+    }
+    counts.push_back(max_workers);
+
+    const size_t jobs = opts.quick ? 50'000 : 500'000;
+    for (size_t workers : counts) {
+        executor exec(workers);
+        bench_result r = run_fanout(exec, jobs, source::worker, busy_tick);
+        r.name = "scaling";
+        r.variant = "busy_1us";
+        report(r);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            opts.json = true;
+        } else if (std::strcmp(argv[i], "--quick") == 0) {
+            opts.quick = true;
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            opts.filter = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--json] [--quick] [--filter <substring>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct bench {
+        const char* name;
+        void (*run)();
+    };
+    const bench benches[] = {
+        {"schedule", bench_schedule},
+        {"nested_await", bench_nested_await},
+        {"when_all", bench_when_all},
+        {"sync_wait", bench_sync_wait},
+        {"async_delay", bench_async_delay},
+        {"priority", bench_priority},
+        {"wakeup", bench_wakeup},
+        {"scaling", bench_scaling},
+    };
+
+    for (const auto& b : benches) {
+        if (selected(b.name)) {
+            b.run();
+        }
+    }
+    return 0;
+}
@@ -15,13 +15,6 @@
 
 using namespace std::chrono_literals;
 
-// Fire-and-forget helper: Start a task and detach it
-// The task will run independently and clean itself up when done
-void start_task(task<void>&& t) {
-    // detach() already calls resume() internally, don't call it twice!
-    t.detach();    // Release ownership - coroutine will self-destruct when done
-}
-
 // HTTP Request structure
 struct HttpRequest {
     std::string method;
@@ -84,26 +77,16 @@ HttpRequest parse_request(const std::string& raw) {
     return req;
 }
 
-// Async read from socket
+// Async read from socket: suspends on the reactor until data arrives
 task<int> async_read(int socket_fd, char* buffer, size_t size) {
-    co_await schedule_on(get_global_executor());
-    
-    // Simulate async I/O with delay
-    co_await async_delay(10ms);
-    
-    ssize_t bytes_read = recv(socket_fd, buffer, size, 0);
+    ssize_t bytes_read = co_await async_recv(socket_fd, buffer, size);
     co_return bytes_read > 0 ? static_cast<int>(bytes_read) : 0;
 }
 
-// Async write to socket
+// Async write to socket: suspends while the send buffer is full
 task<int> async_write(int socket_fd, const std::string& data) {
-    co_await schedule_on(get_global_executor());
-    
-    // Simulate async I/O with delay
-    co_await async_delay(5ms);
-    
-    send(socket_fd, data.c_str(), data.size(), 0);
-    co_return static_cast<int>(data.size());
+    ssize_t bytes_sent = co_await async_send(socket_fd, data.data(), data.size());
+    co_return bytes_sent > 0 ? static_cast<int>(bytes_sent) : 0;
 }
 
 // Simulate database query
@@ -277,10 +260,37 @@ task<void> handle_client(int client_fd) {
         std::println("[ERROR] Exception handling client: {}", e.what());
     }
     
-    close(client_fd);
+    close_socket(client_fd);
     co_return;
 }
 
+// Accept loop: suspends on the reactor instead of blocking in accept()
+task<void> accept_connections(int server_fd) {
+    co_await schedule_on(get_global_executor());
+    
+    while (true) {
+        int client_fd = static_cast<int>(co_await async_accept(server_fd));
+        if (client_fd < 0) {
+            // Back off on errors such as EMFILE instead of spinning
+            co_await async_delay(10ms);
+            continue;
+        }
+        
+        std::println("[ACCEPT] New connection - FD: {}", client_fd);
+        
+        // Handle client asynchronously (fire and forget). submit() goes
+        // through the executor's bounded queue: when workers fall behind, the
+        // accept loop waits here and new connections back up in the kernel's
+        // listen backlog instead of piling up as coroutine frames
+        auto handler = handle_client(client_fd).release_detached();
+        if (!co_await get_global_executor().submit(handler)) {
+            handler.destroy();  // Shutting down
+            close_socket(client_fd);
+            co_return;
+        }
+    }
+}
+
 // Simple HTTP server
 void run_server(int port) {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -304,7 +314,7 @@ void run_server(int port) {
         return;
     }
     
-    if (listen(server_fd, 10) < 0) {
+    if (listen(server_fd, SOMAXCONN) < 0) {
         std::println("Failed to listen on socket");
         close(server_fd);
         return;
@@ -314,25 +324,13 @@ void run_server(int port) {
     std::println("║  Async Coroutine HTTP Server            ║");
     std::println("╚══════════════════════════════════════════╝");
     std::println("Server listening on http://localhost:{}", port);
+    std::println("I/O backend: {}", io_backend_name());
     std::println("Press Ctrl+C to stop\n");
     
-    // Accept connections
-    while (true) {
-        sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-        
-        int client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
-        if (client_fd < 0) {
-            continue;
-        }
-        
-        std::println("[ACCEPT] New connection - FD: {}", client_fd);
-        
-        // Handle client asynchronously (fire and forget)
-        start_task(handle_client(client_fd));
-    }
+    // Accept connections on the reactor
+    sync_wait(accept_connections(server_fd));
     
-    close(server_fd);
+    close_socket(server_fd);
 }
 
 int main(int argc, char* argv[]) {
@@ -103,21 +103,15 @@ std::map<std::string, std::string> parse_headers(const std::string& raw) {
     return headers;
 }
 
-// Async read from socket
+// Async read from socket: suspends on the reactor until data arrives
 task<int> async_read(int socket_fd, char* buffer, size_t size) {
-    co_await schedule_on(get_global_executor());
-    co_await async_delay(1ms);
-    
-    ssize_t bytes_read = recv(socket_fd, buffer, size, 0);
+    ssize_t bytes_read = co_await async_recv(socket_fd, buffer, size);
     co_return bytes_read > 0 ? static_cast<int>(bytes_read) : 0;
 }
 
-// Async write to socket
+// Async write to socket: suspends while the send buffer is full
 task<int> async_write(int socket_fd, const void* data, size_t size) {
-    co_await schedule_on(get_global_executor());
-    co_await async_delay(1ms);
-    
-    ssize_t bytes_sent = send(socket_fd, data, size, 0);
+    ssize_t bytes_sent = co_await async_send(socket_fd, data, size);
     co_return bytes_sent > 0 ? static_cast<int>(bytes_sent) : 0;
 }
 
@@ -329,30 +323,36 @@ struct ChatUser {
     std::chrono::system_clock::time_point join_time;
 };
 
-// Chat room state
+// Chat room state; a contended async_mutex suspends the coroutine instead
+// of blocking an executor worker
 std::vector<ChatUser> chat_users;
-std::mutex users_mutex;
-int next_user_id = 1;
+async_mutex users_mutex;
+int next_user_id = 1;  // Guarded by users_mutex
 
 // Helper: Find user by fd
-std::optional<ChatUser> find_user(int fd) {
-    std::lock_guard lock(users_mutex);
+task<std::optional<ChatUser>> find_user(int fd) {
+    auto lock = co_await users_mutex.scoped_lock();
     for (const auto& user : chat_users) {
         if (user.fd == fd) {
-            return user;
+            co_return user;
         }
     }
-    return std::nullopt;
+    co_return std::nullopt;
 }
 
 // Helper: Get all usernames
-std::vector<std::string> get_all_usernames() {
-    std::lock_guard lock(users_mutex);
+task<std::vector<std::string>> get_all_usernames() {
+    auto lock = co_await users_mutex.scoped_lock();
     std::vector<std::string> names;
     for (const auto& user : chat_users) {
         names.push_back(user.nickname);
     }
-    return names;
+    co_return names;
+}
+
+// One broadcast delivery; a failed send is noticed by that client's reader
+task<void> send_text(int fd, const std::string& message) {
+    co_await ws_send_frame(fd, WSOpcode::TEXT, message);
 }
 
 // Broadcast message to all clients
@@ -361,7 +361,7 @@ task<void> broadcast_message(const std::string& message, int exclude_fd = -1) {
     
     std::vector<int> client_fds;
     {
-        std::lock_guard lock(users_mutex);
+        auto lock = co_await users_mutex.scoped_lock();
         for (const auto& user : chat_users) {
             if (user.fd != exclude_fd) {
                 client_fds.push_back(user.fd);
@@ -369,16 +369,21 @@ task<void> broadcast_message(const std::string& message, int exclude_fd = -1) {
         }
     }
     
+    // Send to every client concurrently; when_all hands the whole fan-out to
+    // the executor with one schedule_bulk()
+    std::vector<task<void>> sends;
+    sends.reserve(client_fds.size());
     for (int fd : client_fds) {
-        co_await ws_send_frame(fd, WSOpcode::TEXT, message);
+        sends.push_back(send_text(fd, message));
     }
+    co_await when_all_void(std::move(sends));
 }
 
 // Send user list update to all clients
 task<void> broadcast_user_list() {
     co_await schedule_on(get_global_executor());
     
-    auto usernames = get_all_usernames();
+    auto usernames = co_await get_all_usernames();
     std::ostringstream oss;
     oss << "{\"type\":\"userlist\",\"users\":[";
     for (size_t i = 0; i < usernames.size(); i++) {
@@ -402,7 +407,7 @@ task<void> handle_websocket_client(int client_fd) {
         bool handshake_ok = co_await ws_handshake(client_fd);
         if (!handshake_ok) {
             std::println("[CHAT] Handshake failed - FD: {}", client_fd);
-            close(client_fd);
+            close_socket(client_fd);
             co_return;
         }
         
@@ -439,13 +444,13 @@ task<void> handle_websocket_client(int client_fd) {
                 // If user not registered yet, this is their nickname
                 if (!user_registered) {
                     user_nickname = message;
-                    if (user_nickname.empty() || user_nickname.size() > 20) {
-                        user_nickname = "User" + std::to_string(next_user_id++);
-                    }
                     
                     // Add user to chat room
                     {
-                        std::lock_guard lock(users_mutex);
+                        auto lock = co_await users_mutex.scoped_lock();
+                        if (user_nickname.empty() || user_nickname.size() > 20) {
+                            user_nickname = "User" + std::to_string(next_user_id++);
+                        }
                         chat_users.push_back({
                             client_fd,
                             user_nickname,
@@ -489,7 +494,7 @@ task<void> handle_websocket_client(int client_fd) {
     
     // Remove from chat room
     {
-        std::lock_guard lock(users_mutex);
+        auto lock = co_await users_mutex.scoped_lock();
         chat_users.erase(
             std::remove_if(chat_users.begin(), chat_users.end(),
                           [client_fd](const ChatUser& u) { return u.fd == client_fd; }),
@@ -509,10 +514,29 @@ task<void> handle_websocket_client(int client_fd) {
         std::println("[CHAT] {} left the chat", user_nickname);
     }
     
-    close(client_fd);
+    close_socket(client_fd);
     co_return;
 }
 
+// Accept loop: suspends on the reactor instead of blocking in accept()
+task<void> accept_connections(int server_fd) {
+    co_await schedule_on(get_global_executor());
+    
+    while (true) {
+        int client_fd = static_cast<int>(co_await async_accept(server_fd));
+        if (client_fd < 0) {
+            // Back off on errors such as EMFILE instead of spinning
+            co_await async_delay(10ms);
+            continue;
+        }
+        
+        std::println("[ACCEPT] New connection - FD: {}", client_fd);
+        
+        // Handle client asynchronously
+        handle_websocket_client(client_fd).detach();
+    }
+}
+
 // WebSocket server
 void run_websocket_server(int port) {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -535,7 +559,7 @@ void run_websocket_server(int port) {
         return;
     }
     
-    if (listen(server_fd, 10) < 0) {
+    if (listen(server_fd, SOMAXCONN) < 0) {
         std::println("Failed to listen on socket");
         close(server_fd);
         return;
@@ -545,26 +569,14 @@ void run_websocket_server(int port) {
     std::println("║  💬 WebSocket Chat Room (C++23)         ║");
     std::println("╚══════════════════════════════════════════╝");
     std::println("🚀 Server listening on ws://localhost:{}", port);
+    std::println("I/O backend: {}", io_backend_name());
     std::println("📝 HTTP UI: http://localhost:{}", port);
     std::println("Press Ctrl+C to stop\n");
     
-    // Accept connections
-    while (true) {
-        sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-        
-        int client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
-        if (client_fd < 0) {
-            continue;
-        }
-        
-        std::println("[ACCEPT] New connection - FD: {}", client_fd);
-        
-        // Handle client asynchronously
-        handle_websocket_client(client_fd).detach();
-    }
+    // Accept connections on the reactor
+    sync_wait(accept_connections(server_fd));
     
-    close(server_fd);
+    close_socket(server_fd);
 }
 
 int main(int argc, char* argv[]) {